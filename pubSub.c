@@ -1,6 +1,23 @@
+#define _GNU_SOURCE // For clock_gettime, and the CPU affinity calls
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 
 /* pubSub.c
  *  
@@ -9,197 +26,4469 @@
  * written November 2019 (?) by Thomas Pinkava
  */
 
-#define THREAD_COUNT 4  // The number of execution threads to employ
-#define MAX_PUBLISHABLE_EVENTS 512 // Per tick, a primitive guard against infinite recursions
+#ifndef THREAD_COUNT
+#define THREAD_COUNT 4  // The default number of execution threads to employ (see executorConfig_t)
+#endif
+#define MAX_PUBLISHABLE_EVENTS 512 // Per tick, a primitive guard against infinite recursions
+
+#define EVENT_TYPE_CHUNK 256    // Event types per registry chunk
+#define EVENT_TYPE_CHUNKS 1024  // Registry chunks, bounding the number of event types (256k)
+#define NO_EVENT_TYPE UINT_MAX  // Stands for "no such event type" in the registry
+#define NO_SUBSCRIBER UINT_MAX  // Stands for "no such subscriber"
+
+// Event queue backends, chosen at build time with -DEVENT_QUEUE_BACKEND=<n>
+#define EVENT_QUEUE_MUTEX_STACK 0   // Mutex-guarded LIFO linked list
+#define EVENT_QUEUE_LOCKFREE_RING 1 // Bounded lock-free MPMC ring (FIFO)
+#ifndef EVENT_QUEUE_BACKEND
+#define EVENT_QUEUE_BACKEND EVENT_QUEUE_MUTEX_STACK
+#endif
+#define EVENT_RING_CAPACITY 2048 // Ring backend slots; a power of two covering the stack's seed events plus a tick's budget
+
+// Event node allocators, chosen at build time with -DEVENT_ALLOCATOR=<n>
+#define EVENT_ALLOCATOR_MALLOC 0 // Straight malloc/free per event
+#define EVENT_ALLOCATOR_SLAB 1   // Per-thread caches of slab-allocated nodes
+#ifndef EVENT_ALLOCATOR
+#define EVENT_ALLOCATOR EVENT_ALLOCATOR_SLAB
+#endif
+#define EVENT_SLAB_SIZE MAX_PUBLISHABLE_EVENTS // Nodes per slab; each thread starts with one slab
+#define EVENT_CACHE_SLOTS 64 // Threads that get their own node cache; any more share a locked one
+
+#define WORKER_DEQUE_CAPACITY 1024 // Per-executor deque slots (power of two); overflow goes to the event stack
+#define PRIORITY_LEVELS 3       // Dispatch priorities; each has a FIFO lane (0's is for ordered types only)
+#define LANE_RING_CAPACITY 1024 // Slots per lane (power of two)
+#define FORWARD_INBOX_CAPACITY 1024 // Events other buses can have waiting to be taken in by a stack (power of two)
+
+// Event stack shards, each with its own queue and tick budget, chosen at build time with -DEVENT_SHARDS=<n>
+#ifndef EVENT_SHARDS
+#define EVENT_SHARDS 1
+#endif
+#ifndef SHARD_PUBLISHABLE_EVENTS
+#define SHARD_PUBLISHABLE_EVENTS (MAX_PUBLISHABLE_EVENTS / EVENT_SHARDS) // Per shard, per tick
+#endif
+
+#define EXECUTOR_POP_BATCH 32      // The most events an executor takes from the event stack at once
+#ifndef EXECUTOR_SPIN_LIMIT
+#define EXECUTOR_SPIN_LIMIT 0      // Default empty polls an idle executor makes before parking
+#endif
+
+// Backpressure policies, for events over their shard's tick budget or whose queue is full
+#define BACKPRESSURE_DROP 0        // Drop the new event, releasing its data (counted, and reported now and then)
+#define BACKPRESSURE_BLOCK 1       // Block the producer until there is room (executors drop instead)
+#define BACKPRESSURE_DROP_OLDEST 2 // Drop the oldest event queued with it instead
+#define BACKPRESSURE_ERROR 3       // Leave the event (and its data) to the caller, with PUBLISH_REJECTED
+#ifndef EVENT_BACKPRESSURE
+#define EVENT_BACKPRESSURE BACKPRESSURE_DROP // New stacks' policy, chosen at build time with -DEVENT_BACKPRESSURE=<n>
+#endif
+#define DROP_REPORT_INTERVAL_NS 1000000000ULL // The most often dropped events are reported to stderr
+
+// Coalescing policies, for event types whose pending events are idempotent (see setEventCoalescing)
+#define COALESCE_NONE 0 // Every event published is dispatched
+#define COALESCE_TYPE 1 // At most one event of the type is pending; publishing another folds it in
+#define COALESCE_KEY 2  // At most one per type and key (see publishKeyed)
+#define COALESCE_BUCKETS 1024 // Buckets in each event stack's table of pending coalescing events
+#define COALESCE_STRIPES 64   // Locks over those buckets
+
+// Deferred events (see publishAt and publishAfterTicks)
+#define TIMER_LEVELS 5     // Levels in each timing wheel (together spanning 2^30 time units)
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS) // Slots per level
+#ifndef TIMER_RESOLUTION_SHIFT
+#define TIMER_RESOLUTION_SHIFT 20 // Clock timers run in units of 2^20 ns (about a millisecond)
+#endif
+#define TIMER_POLL_EVENTS 64 // A busy streaming executor checks the clock for due timers this often
+
+#define EVENT_INLINE_BYTES 32 // Payloads up to this size are stored inside the event itself
+#define EVENT_BATCH_SIZE 64   // Events gathered per publishBatch when feeding a stack from a log or another process
+#define SHM_PAYLOAD_BYTES 104 // Payload bytes carried in each shared-memory ring slot (making slots 128 bytes)
+#define SHM_RING_MAGIC 0x52485350u // "PSHR": set in a shared-memory ring once it is ready
+
+#define CACHE_LINE_SIZE 64 // For padding apart data written by different threads
+
+#ifndef PUBSUB_STATS
+#define PUBSUB_STATS 1 // Hot-path counters (see pubsub_stats); -DPUBSUB_STATS=0 compiles them out
+#endif
+#define STATS_SLOTS 64 // Threads that get counters of their own; any more share one
+#define STATS_TYPES 64 // Event types counted one by one (the first registered)
+
+#ifndef PUBSUB_TIMING
+#define PUBSUB_TIMING 0 // Per-subscriber execution time histograms (see subscriberTiming_dump)
+#endif
+#ifndef PUBSUB_TRACE
+#define PUBSUB_TRACE 1 // Event causality tracing, off until trace_start (see trace_export)
+#endif
+#define TRACE_RING_ENTRIES 16384 // Traced dispatches kept per thread (the oldest are overwritten)
+#ifndef PUBSUB_RECORD
+#define PUBSUB_RECORD 1 // Event log recording, off until record_start (see replay_run)
+#endif
+#define RECORD_BUFFER_BYTES 65536 // Bytes of records each thread buffers before the log writer takes them
+#define RECORD_MAX_BYTES (RECORD_BUFFER_BYTES - sizeof(recordHeader_t)) // The most data one record can hold
+#define RECORD_MAGIC 0x4c525350u  // "PSRL": the first word of every event log
+#define RECORD_VERSION 1          // The event log format's version, its second word
+#define HIST_SUB_BITS 2    // Histogram buckets per power of two, as a power of two (so within 25%)
+#define HIST_BUCKETS 160   // Histogram buckets, covering up to 2^40 ns; longer times land in the last
+#define TIMING_CHUNK 16    // Subscribers' histograms per per-thread timing chunk
+#define TIMING_CHUNKS 4096 // Timing chunks per thread, bounding the number of subscribers timed (64k)
+
+
+// ========== INSTRUMENTATION ==========
+// Claim a free slot of a per-thread registry (one ownership flag per slot), raising its count of
+// slots ever used to cover it; returns slotCount if every slot is taken
+unsigned int claimThreadSlot(atomic_uchar *owned, unsigned int slotCount, atomic_uint *slotsUsed){
+    for(unsigned int slot = 0; slot < slotCount; slot++){
+        unsigned char free = 0;
+        if(atomic_load_explicit(&(owned[slot]), memory_order_relaxed) == 0 && atomic_compare_exchange_strong_explicit(&(owned[slot]), &free, 1, memory_order_acquire, memory_order_relaxed)){
+            unsigned int used = atomic_load(slotsUsed);
+            while(used < slot + 1 && !atomic_compare_exchange_weak(slotsUsed, &used, slot + 1));
+            return slot;
+        }
+    }
+    return slotCount;
+}
+
+// Give a per-thread registry slot back for the next thread to claim, along with what is in it
+void releaseThreadSlot(atomic_uchar *owned, unsigned int slot){
+    atomic_store_explicit(&(owned[slot]), 0, memory_order_release);
+}
+
+#if PUBSUB_STATS
+// One thread's hot-path counters, on cache lines of their own (only that thread writes them)
+typedef struct threadStats{
+    _Alignas(CACHE_LINE_SIZE) atomic_ulong published; // Events queued
+    atomic_ulong dispatched;      // Events run through their subscribers
+    atomic_ulong subscriberCalls; // Subscriber functions run
+    atomic_ulong stackPops;       // Events taken off the event stack's shards and lanes
+    atomic_ulong dequePops;       // Events taken off the executor's own deque
+    atomic_ulong steals;          // Events stolen off a peer's deque
+    atomic_ulong parks;           // Times an executor parked for want of events
+    atomic_ulong lockContended;   // Lock acquisitions that found the lock taken
+    atomic_ulong coalesced;       // Events folded into pending ones instead of queued
+    atomic_ulong typePublished[STATS_TYPES];  // Events queued, by type
+    atomic_ulong typeDispatched[STATS_TYPES]; // Events dispatched, by type
+} threadStats_t;
+
+// All threads' counters: one slot per thread up to STATS_SLOTS, then one shared by the rest
+typedef struct statsRegistry{
+    threadStats_t slots[STATS_SLOTS];
+    atomic_uchar slotOwned[STATS_SLOTS]; // Nonzero while a thread has the slot
+    atomic_uint slotsClaimed;     // Slots ever used (slots are given back as threads exit)
+    threadStats_t shared;         // Updated with atomic adds, being shared
+} statsRegistry_t;
+
+statsRegistry_t gStats;
+
+// The calling thread's counters (NULL until its first count)
+_Thread_local threadStats_t *tStats = NULL;
+
+// Find the calling thread's counters, claiming a slot on first use
+threadStats_t *threadStats(void){
+    threadStats_t *stats = tStats;
+    if(stats == NULL){
+        unsigned int slot = claimThreadSlot(gStats.slotOwned, STATS_SLOTS, &(gStats.slotsClaimed));
+        stats = (slot < STATS_SLOTS) ? &(gStats.slots[slot]) : &(gStats.shared);
+        tStats = stats;
+    }
+    return stats;
+}
+
+// Give the calling thread's counter slot back as it exits (its counts stay in the totals, and
+// the next thread to claim the slot adds to them)
+void stats_releaseThread(void){
+    if(tStats != NULL && tStats != &(gStats.shared)) releaseThreadSlot(gStats.slotOwned, (unsigned int)(tStats - gStats.slots));
+    tStats = NULL;
+}
+
+// Add to one of a thread's counters: a plain load and store, as no other thread writes it
+// (but readers may look at any time, hence the relaxed atomics)
+void statsAdd(threadStats_t *stats, atomic_ulong *counter, unsigned long n){
+    if(stats == &(gStats.shared)){
+        atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+    } else {
+        atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+    }
+}
+
+// Take back from one of a thread's counters what it added for events that turned out not to
+// be queued after all (so never more than the thread itself has added)
+void statsSub(threadStats_t *stats, atomic_ulong *counter, unsigned long n){
+    if(stats == &(gStats.shared)){
+        atomic_fetch_sub_explicit(counter, n, memory_order_relaxed);
+    } else {
+        atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) - n, memory_order_relaxed);
+    }
+}
+
+#define STATS_ADD(counter, n) do { threadStats_t *stats_ = threadStats(); statsAdd(stats_, &(stats_->counter), (n)); } while(0)
+#define STATS_ADD_TYPE(counter, eventType, n) do { if((eventType) < STATS_TYPES){ threadStats_t *stats_ = threadStats(); statsAdd(stats_, &(stats_->counter[(eventType)]), (n)); } } while(0)
+#define STATS_SUB(counter, n) do { threadStats_t *stats_ = threadStats(); statsSub(stats_, &(stats_->counter), (n)); } while(0)
+#define STATS_SUB_TYPE(counter, eventType, n) do { if((eventType) < STATS_TYPES){ threadStats_t *stats_ = threadStats(); statsSub(stats_, &(stats_->counter[(eventType)]), (n)); } } while(0)
+#else
+#define STATS_ADD(counter, n) ((void)0)
+#define STATS_ADD_TYPE(counter, eventType, n) ((void)0)
+#define STATS_SUB(counter, n) ((void)0)
+#define STATS_SUB_TYPE(counter, eventType, n) ((void)0)
+#endif
+
+// A snapshot of the bus's counters (see pubsub_stats)
+typedef struct pubsubStats{
+    unsigned long published;      // Events queued
+    unsigned long dispatched;     // Events run through their subscribers
+    unsigned long subscriberCalls; // Subscriber functions run
+    unsigned long stackPops;      // Events taken off the event stack's shards and lanes
+    unsigned long dequePops;      // Events taken off executors' own deques
+    unsigned long steals;         // Events stolen off peers' deques
+    unsigned long parks;          // Times executors parked for want of events
+    unsigned long lockContended;  // Lock acquisitions that found the lock taken
+    unsigned long coalesced;      // Events folded into pending ones instead of queued
+    unsigned long dropped;        // Events dropped by the stack's backpressure policy
+    unsigned int queued;          // Events on the stack's shards and lanes right now
+    unsigned int pending;         // Events published but not yet fully processed
+    unsigned int epoch;           // The stack's budget epoch
+    unsigned int deferred;        // Events waiting on the stack's timing wheels
+    unsigned long typePublished[STATS_TYPES];  // Events queued, by type
+    unsigned long typeDispatched[STATS_TYPES]; // Events dispatched, by type
+} pubsubStats_t;
+
+#if PUBSUB_STATS
+// Sum every thread's counters into a snapshot (each read relaxed, so only roughly consistent)
+void statsCollect(pubsubStats_t *out){
+    unsigned int claimed = atomic_load(&(gStats.slotsClaimed));
+    if(claimed > STATS_SLOTS) claimed = STATS_SLOTS;
+    memset(out, 0, sizeof(pubsubStats_t));
+    for(unsigned int i = 0; i <= claimed; i++){
+        threadStats_t *stats = (i == claimed) ? &(gStats.shared) : &(gStats.slots[i]);
+        out->published += atomic_load_explicit(&(stats->published), memory_order_relaxed);
+        out->dispatched += atomic_load_explicit(&(stats->dispatched), memory_order_relaxed);
+        out->subscriberCalls += atomic_load_explicit(&(stats->subscriberCalls), memory_order_relaxed);
+        out->stackPops += atomic_load_explicit(&(stats->stackPops), memory_order_relaxed);
+        out->dequePops += atomic_load_explicit(&(stats->dequePops), memory_order_relaxed);
+        out->steals += atomic_load_explicit(&(stats->steals), memory_order_relaxed);
+        out->parks += atomic_load_explicit(&(stats->parks), memory_order_relaxed);
+        out->lockContended += atomic_load_explicit(&(stats->lockContended), memory_order_relaxed);
+        out->coalesced += atomic_load_explicit(&(stats->coalesced), memory_order_relaxed);
+        for(int j = 0; j < STATS_TYPES; j++){
+            out->typePublished[j] += atomic_load_explicit(&(stats->typePublished[j]), memory_order_relaxed);
+            out->typeDispatched[j] += atomic_load_explicit(&(stats->typeDispatched[j]), memory_order_relaxed);
+        }
+    }
+}
+#else
+// No counters to sum with PUBSUB_STATS=0: they all read zero
+void statsCollect(pubsubStats_t *out){
+    memset(out, 0, sizeof(pubsubStats_t));
+}
+
+// No counter slot to give back with PUBSUB_STATS=0
+void stats_releaseThread(void){
+}
+#endif
+
+
+
+// ========== LOCKING HELPERS ==========
+// Acquire a mutex, bailing out entirely on failure
+void acquireLock(pthread_mutex_t *lock){
+#if PUBSUB_STATS
+    // Count it if we have to wait
+    int failed = pthread_mutex_trylock(lock);
+    if(failed == 0) return;
+    if(failed != EBUSY){
+        errno = failed;
+        perror("Locking failed");
+        exit(2);
+    }
+    STATS_ADD(lockContended, 1);
+#endif
+    if(pthread_mutex_lock(lock)){
+        perror("Locking failed");
+        exit(2);
+    }
+}
+
+// Relinquish a mutex, bailing out entirely on failure
+void releaseLock(pthread_mutex_t *lock){
+    if(pthread_mutex_unlock(lock)){
+        perror("Unlocking failed");
+        exit(2);
+    }
+}
+
+// Read a monotonic clock, in nanoseconds
+unsigned long long nowNanos(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+// Hint to the CPU that the calling thread is spin-waiting
+void cpuRelax(void){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+
+
+// ========== SUBSCRIPTION DEFINITIONS ==========
+// A function that releases an event's data once every subscriber has run
+typedef void (*eventRelease_t)(void *data);
+
+// Release for data the bus doesn't own (borrowed references, zero-copy views): does nothing
+void releaseBorrowed(void *data){
+}
+
+// A function that merges a newly published event's data into that of the pending event it is
+// coalesced into (the new data is released as usual afterwards)
+typedef void (*eventReducer_t)(void *pendingData, const void *newData);
+
+// The handle a running subscriber publishes through (see publisher_publish)
+typedef struct publisher publisher_t;
+
+// A subscriber function: handed the context it was subscribed with, the event's data, and a
+// handle for publishing further events from the worker running it
+typedef void (*subscriberFunction_t)(void *ctx, void *data, publisher_t *publisher);
+
+// A node in a list of event subscribers
+typedef struct subscriberNode{
+    subscriberFunction_t subscriberFunction; // The subscriber function
+    void *ctx;                               // Its context, as given to subscribe
+    unsigned int id;                         // The subscription's ID (dense, in subscription order)
+    struct subscriberNode *next;             // Linked List Link
+} subscriberNode_t;
+
+// A subscriber as laid out in a dispatch table
+typedef struct subscriberEntry{
+    subscriberFunction_t subscriberFunction; // The subscriber function
+    void *ctx;                               // Its context
+    unsigned int id;                         // The subscription's ID
+} subscriberEntry_t;
+
+// The frozen, read-optimised form of a subscriber set's lists (compressed sparse rows:
+// all subscribers sit in one array, each event type's contiguous, so dispatch is a linear scan).
+// A published table is never changed: subscribing makes a new one, and the old is retired.
+typedef struct dispatchTable{
+    unsigned int typeCount;     // The number of event types the table covers
+    unsigned int *offsets;      // Type t's subscribers are entries[offsets[t]] up to entries[offsets[t + 1]]
+    subscriberEntry_t *entries;
+    unsigned int *fanouts;      // Type t's events are dispatched fanouts[t] subscribers per task (0: all on one worker)
+    unsigned long retiredAt;    // The table version that replaced it (once retired)
+    struct dispatchTable *nextRetired; // Linked List Link (once retired)
+} dispatchTable_t;
+
+// Something dispatching from a subscriber set (an executor pool), as far as reclaiming retired
+// tables goes: between its ticks it holds no table, during one it may hold any published since
+// the tick began
+typedef struct tableReader{
+    unsigned long epoch;        // The table version when its current tick began (READER_OFFLINE between ticks)
+    struct tableReader *next;   // Linked List Link
+} tableReader_t;
+
+#define READER_OFFLINE ULONG_MAX
+
+// Everything the bus knows about one registered event type
+typedef struct eventTypeInfo{
+    char *name;                   // The type's registered name (NULL if anonymous)
+    subscriberNode_t *subscribers; // The type's subscribers, most recent first
+    eventRelease_t release;       // How the type's event data is released by default
+    unsigned int priority;        // Dispatch priority, 0 (normal) up to PRIORITY_LEVELS - 1
+    int ordered;                  // Nonzero if the type's events must start dispatch in publish order
+    unsigned int shard;           // The event stack shard holding the type's events, below EVENT_SHARDS
+    unsigned int budget;          // The most events of the type published per tick, on top of the shard's (0 for no limit)
+    int coalesce;                 // Whether pending events of the type absorb new ones (COALESCE_*)
+    eventReducer_t reducer;       // How absorbed events' data is merged (NULL to just discard it)
+    unsigned int fanout;          // Subscribers per parallel task (0 to run them all on one worker)
+    size_t recordBytes;           // Bytes of its events' data an event log keeps (for data published by pointer)
+} eventTypeInfo_t;
+
+// A set of all event subscribers, ordered by event type, doubling as the event type registry
+// (types get dense IDs in registration order; their records live in fixed-size chunks, so
+//  registering more never moves the ones already handed out)
+typedef struct subscriberSet{
+    eventTypeInfo_t *typeChunks[EVENT_TYPE_CHUNKS]; // EVENT_TYPE_CHUNK types each, allocated as needed
+    unsigned int typeCount;       // The number of registered types
+    unsigned int *nameSlots;      // Open-addressed name -> ID table (NO_EVENT_TYPE if free)
+    unsigned int nameCapacity;    // Slots in the name table (a power of two)
+    unsigned int nameCount;       // Named types in the name table
+    unsigned int subscriberCount; // Subscriptions made (the next subscription's ID)
+    _Atomic(dispatchTable_t *) table; // What the executors actually dispatch from
+    pthread_mutex_t writeLock;    // Guards the subscriber lists and all the fields below
+    int frozen;                   // Nonzero while the table matches the lists
+    unsigned long tableVersion;   // Bumped whenever a new table is published
+    dispatchTable_t *retired;     // Replaced tables a reader may still hold, most recently retired first
+    tableReader_t *readers;       // Everything dispatching from the set
+} subscriberSet_t;
+
+// Look up a registered event type's record (O(1): a chunk index and an offset)
+eventTypeInfo_t *getEventType(const subscriberSet_t *sSet, unsigned int eventType){
+    return &(sSet->typeChunks[eventType / EVENT_TYPE_CHUNK][eventType % EVENT_TYPE_CHUNK]);
+}
+
+// Hash an event type name (FNV-1a; only ever used at registration time)
+unsigned int hashEventTypeName(const char *name){
+    unsigned int hash = 2166136261u;
+    while(*name != '\0'){
+        hash = (hash ^ (unsigned char)*(name++)) * 16777619u;
+    }
+    return hash;
+}
+
+// Find the name table slot holding the given name, or the free slot where it would go
+unsigned int findEventTypeNameSlot(const subscriberSet_t *sSet, const char *name){
+    unsigned int slot = hashEventTypeName(name) & (sSet->nameCapacity - 1);
+    while(sSet->nameSlots[slot] != NO_EVENT_TYPE && strcmp(getEventType(sSet, sSet->nameSlots[slot])->name, name) != 0){
+        slot = (slot + 1) & (sSet->nameCapacity - 1);
+    }
+    return slot;
+}
+
+// Initialize a subscriber set (no types registered yet)
+void initSubscriberSet(subscriberSet_t *sSet){
+    for(int i = 0; i < EVENT_TYPE_CHUNKS; i++){
+        sSet->typeChunks[i] = NULL;
+    }
+    sSet->typeCount = 0;
+    sSet->subscriberCount = 0;
+    sSet->nameCapacity = EVENT_TYPE_CHUNK;
+    sSet->nameCount = 0;
+    sSet->nameSlots = (unsigned int *)malloc(sSet->nameCapacity * sizeof(unsigned int)); // Perhaps add error checking
+    for(unsigned int i = 0; i < sSet->nameCapacity; i++){
+        sSet->nameSlots[i] = NO_EVENT_TYPE;
+    }
+    dispatchTable_t *table = (dispatchTable_t *)malloc(sizeof(dispatchTable_t)); // Perhaps add error checking
+    table->typeCount = 0;
+    table->offsets = (unsigned int *)calloc(1, sizeof(unsigned int)); // Perhaps add error checking
+    table->entries = NULL;
+    table->fanouts = NULL;
+    atomic_init(&(sSet->table), table);
+    pthread_mutex_init(&(sSet->writeLock), NULL);
+    sSet->frozen = 1;
+    sSet->tableVersion = 0;
+    sSet->retired = NULL;
+    sSet->readers = NULL;
+}
+
+// Deallocate a dispatch table
+void dispatchTable_free(dispatchTable_t *table){
+    free(table->offsets);
+    free(table->entries);
+    free(table->fanouts);
+    free(table);
+}
+
+// Deallocate a subscriber set
+void destroySubscriberSet(subscriberSet_t *sSet){
+    for(unsigned int i = 0; i < sSet->typeCount; i++){
+        eventTypeInfo_t *info = getEventType(sSet, i);
+        // Linked-List free all nodes in the ith bucket
+        subscriberNode_t *temp;
+        while(info->subscribers != NULL){
+            temp = info->subscribers;
+            info->subscribers = temp->next;
+            free(temp);
+        }
+        free(info->name);
+    }
+    for(int i = 0; i < EVENT_TYPE_CHUNKS; i++){
+        free(sSet->typeChunks[i]);
+    }
+    free(sSet->nameSlots);
+    dispatchTable_free(atomic_load(&(sSet->table)));
+    while(sSet->retired != NULL){
+        dispatchTable_t *doomedTable = sSet->retired;
+        sSet->retired = doomedTable->nextRetired;
+        dispatchTable_free(doomedTable);
+    }
+    pthread_mutex_destroy(&(sSet->writeLock));
+}
+
+// Set how many bytes of an event type's data an event log records when its events are published
+// by pointer (the data must be at least that big; inline payloads are always recorded whole).
+// Events with over RECORD_MAX_BYTES to record are left out of the log (see recordEvent).
+void setEventRecordBytes(subscriberSet_t *sSet, unsigned int eventType, size_t bytes){
+    if(eventType < sSet->typeCount) getEventType(sSet, eventType)->recordBytes = bytes;
+}
+
+// Compact the subscriber lists into a new dispatch table, keeping each type's subscriber order
+dispatchTable_t *dispatchTable_build(const subscriberSet_t *sSet){
+    dispatchTable_t *table = (dispatchTable_t *)malloc(sizeof(dispatchTable_t)); // Perhaps add error checking
+
+    // Count each type's subscribers into the offsets
+    table->typeCount = sSet->typeCount;
+    table->offsets = (unsigned int *)malloc((table->typeCount + 1) * sizeof(unsigned int)); // Perhaps add error checking
+    unsigned int total = 0;
+    for(unsigned int i = 0; i < table->typeCount; i++){
+        table->offsets[i] = total;
+        for(subscriberNode_t *currentSub = getEventType(sSet, i)->subscribers; currentSub != NULL; currentSub = currentSub->next){
+            total++;
+        }
+    }
+    table->offsets[table->typeCount] = total;
+    table->fanouts = (unsigned int *)malloc((table->typeCount + 1) * sizeof(unsigned int)); // Perhaps add error checking
+    for(unsigned int i = 0; i < table->typeCount; i++){
+        table->fanouts[i] = getEventType(sSet, i)->fanout;
+    }
+
+    // Then lay the subscribers out contiguously
+    table->entries = (subscriberEntry_t *)malloc(total * sizeof(subscriberEntry_t)); // Perhaps add error checking
+    for(unsigned int i = 0; i < table->typeCount; i++){
+        subscriberEntry_t *entry = &(table->entries[table->offsets[i]]);
+        for(subscriberNode_t *currentSub = getEventType(sSet, i)->subscribers; currentSub != NULL; currentSub = currentSub->next){
+            entry->subscriberFunction = currentSub->subscriberFunction;
+            entry->ctx = currentSub->ctx;
+            (entry++)->id = currentSub->id;
+        }
+    }
+    return table;
+}
+
+// Deallocate the retired tables no reader can still hold, with the write lock held: those
+// retired before the oldest tick still running began (quiescent-state reclamation, with a
+// reader's tick boundaries as its quiescent states)
+void subscriberSet_reclaim(subscriberSet_t *sSet){
+    unsigned long oldestEpoch = READER_OFFLINE;
+    for(tableReader_t *reader = sSet->readers; reader != NULL; reader = reader->next){
+        if(reader->epoch < oldestEpoch) oldestEpoch = reader->epoch;
+    }
+
+    // Retired tables are in retirement order, newest first, so everything past the first
+    // one old enough can go too
+    dispatchTable_t **link = &(sSet->retired);
+    while(*link != NULL && (*link)->retiredAt > oldestEpoch){
+        link = &((*link)->nextRetired);
+    }
+    while(*link != NULL){
+        dispatchTable_t *doomedTable = *link;
+        *link = doomedTable->nextRetired;
+        dispatchTable_free(doomedTable);
+    }
+}
+
+// Publish a new dispatch table if the lists have changed, with the write lock held: executors
+// pick it up with their next event, and the old one is retired until no reader can hold it
+void subscriberSet_publishTable(subscriberSet_t *sSet){
+    if(sSet->frozen) return;
+    dispatchTable_t *oldTable = atomic_exchange_explicit(&(sSet->table), dispatchTable_build(sSet), memory_order_acq_rel);
+    oldTable->retiredAt = ++sSet->tableVersion;
+    oldTable->nextRetired = sSet->retired;
+    sSet->retired = oldTable;
+    sSet->frozen = 1;
+    subscriberSet_reclaim(sSet);
+}
+
+// Note a change to the lists, with the write lock held: published straight away while anything
+// dispatches from the set, otherwise left for the first tick (so setting up is linear)
+void subscriberSet_changed(subscriberSet_t *sSet){
+    sSet->frozen = 0;
+    if(sSet->readers != NULL) subscriberSet_publishTable(sSet);
+}
+
+// Publish a dispatch table matching the subscriber lists now, if it doesn't already
+// (the executor pool does this at the start of any tick following a registration or subscribe)
+void freezeSubscriberSet(subscriberSet_t *sSet){
+    acquireLock(&(sSet->writeLock));
+    subscriberSet_publishTable(sSet);
+    releaseLock(&(sSet->writeLock));
+}
+
+// Register a reader of the set's dispatch tables (initially between ticks)
+void subscriberSet_attachReader(subscriberSet_t *sSet, tableReader_t *reader){
+    acquireLock(&(sSet->writeLock));
+    reader->epoch = READER_OFFLINE;
+    reader->next = sSet->readers;
+    sSet->readers = reader;
+    releaseLock(&(sSet->writeLock));
+}
+
+// Unregister a reader (between its ticks), reclaiming whatever only it was holding up
+void subscriberSet_detachReader(subscriberSet_t *sSet, tableReader_t *reader){
+    acquireLock(&(sSet->writeLock));
+    tableReader_t **link = &(sSet->readers);
+    while(*link != NULL && *link != reader){
+        link = &((*link)->next);
+    }
+    if(*link != NULL) *link = reader->next;
+    subscriberSet_reclaim(sSet);
+    releaseLock(&(sSet->writeLock));
+}
+
+// Start a reader's tick: from here until subscriberSet_endTick it may hold any table published
+// since now (also publishes any changes still pending)
+void subscriberSet_beginTick(subscriberSet_t *sSet, tableReader_t *reader){
+    acquireLock(&(sSet->writeLock));
+    subscriberSet_publishTable(sSet);
+    reader->epoch = sSet->tableVersion;
+    releaseLock(&(sSet->writeLock));
+}
+
+// End a reader's tick (a quiescent state: it holds no table now), reclaiming what it can
+void subscriberSet_endTick(subscriberSet_t *sSet, tableReader_t *reader){
+    acquireLock(&(sSet->writeLock));
+    reader->epoch = READER_OFFLINE;
+    subscriberSet_reclaim(sSet);
+    releaseLock(&(sSet->writeLock));
+}
+
+// Find a registered event type by name; returns NO_EVENT_TYPE if there is none
+unsigned int lookupEventType(const subscriberSet_t *sSet, const char *name){
+    return sSet->nameSlots[findEventTypeNameSlot(sSet, name)];
+}
+
+// Register a new event type, returning its (dense) ID; registering a name that is already
+// taken just returns the existing type's ID. Pass NULL for an anonymous type.
+// Unlike subscribe, this is only safe between ticks (publishers read the registry unlocked).
+unsigned int registerEventType(subscriberSet_t *sSet, const char *name){
+    // Reuse the type already registered under this name, if any
+    unsigned int slot = 0;
+    if(name != NULL){
+        slot = findEventTypeNameSlot(sSet, name);
+        if(sSet->nameSlots[slot] != NO_EVENT_TYPE) return sSet->nameSlots[slot];
+    }
+
+    unsigned int eventType = sSet->typeCount;
+    if(eventType >= EVENT_TYPE_CHUNK * EVENT_TYPE_CHUNKS){
+        // TODO: Standardize errors over all TPECS functions
+        fprintf(stderr, "Event type could not be registered (registry full at %u types)\n", eventType);
+        return NO_EVENT_TYPE;
+    }
+    acquireLock(&(sSet->writeLock));
+
+    // Start a new chunk when the last one is full
+    if(eventType % EVENT_TYPE_CHUNK == 0){
+        sSet->typeChunks[eventType / EVENT_TYPE_CHUNK] = (eventTypeInfo_t *)malloc(EVENT_TYPE_CHUNK * sizeof(eventTypeInfo_t)); // Perhaps add error checking
+    }
+    eventTypeInfo_t *info = getEventType(sSet, eventType);
+    info->name = NULL;
+    info->subscribers = NULL;
+    info->release = free;
+    info->priority = 0;
+    info->ordered = 0;
+    info->shard = eventType % EVENT_SHARDS;
+    info->budget = 0;
+    info->coalesce = COALESCE_NONE;
+    info->reducer = NULL;
+    info->fanout = 0;
+    info->recordBytes = 0;
+    sSet->typeCount++;
+    subscriberSet_changed(sSet);
+    releaseLock(&(sSet->writeLock));
+
+    if(name != NULL){
+        size_t nameLength = strlen(name) + 1;
+        info->name = (char *)malloc(nameLength); // Perhaps add error checking
+        memcpy(info->name, name, nameLength);
+        sSet->nameSlots[slot] = eventType;
+        sSet->nameCount++;
+
+        // Keep the name table at most half full, rehashing into one twice the size
+        if(sSet->nameCount * 2 > sSet->nameCapacity){
+            unsigned int *oldSlots = sSet->nameSlots;
+            unsigned int oldCapacity = sSet->nameCapacity;
+            sSet->nameCapacity *= 2;
+            sSet->nameSlots = (unsigned int *)malloc(sSet->nameCapacity * sizeof(unsigned int)); // Perhaps add error checking
+            for(unsigned int i = 0; i < sSet->nameCapacity; i++){
+                sSet->nameSlots[i] = NO_EVENT_TYPE;
+            }
+            for(unsigned int i = 0; i < oldCapacity; i++){
+                if(oldSlots[i] != NO_EVENT_TYPE){
+                    sSet->nameSlots[findEventTypeNameSlot(sSet, getEventType(sSet, oldSlots[i])->name)] = oldSlots[i];
+                }
+            }
+            free(oldSlots);
+        }
+    }
+    return eventType;
+}
+
+// Add a subscriber to the subscriber set, to be called with the given context (which the bus
+// never touches), returning the subscription's ID (NO_SUBSCRIBER if the type isn't registered).
+// Safe at any time, from any thread (subscribers included): events whose dispatch starts after
+// it returns see the new subscriber.
+unsigned int subscribe(subscriberSet_t *sSet, unsigned int eventType, subscriberFunction_t subscriberFunction, void *ctx){
+    acquireLock(&(sSet->writeLock));
+    if(eventType >= sSet->typeCount){
+        releaseLock(&(sSet->writeLock));
+        // TODO: Standardize errors over all TPECS functions
+        fprintf(stderr, "Subscriber to event type %u could not be added (type not registered)\n", eventType);
+        return NO_SUBSCRIBER;
+    }
+    eventTypeInfo_t *info = getEventType(sSet, eventType);
+    subscriberNode_t *newSub = (subscriberNode_t *)malloc(sizeof(subscriberNode_t)); // Perhaps add error checking
+    newSub->subscriberFunction = subscriberFunction;
+    newSub->ctx = ctx;
+    newSub->id = sSet->subscriberCount++;
+    newSub->next = info->subscribers;
+    info->subscribers = newSub;
+    subscriberSet_changed(sSet);
+    unsigned int id = newSub->id;
+    releaseLock(&(sSet->writeLock));
+    return id;
+}
+
+// Remove a subscription by the ID subscribe returned; returns zero if there is no such
+// subscription. Safe at any time, from any thread, like subscribe: events whose dispatch starts
+// after it returns don't call the subscriber, but ones already being dispatched may, so its
+// context must outlive the ticks (or stream) running meanwhile.
+int unsubscribe(subscriberSet_t *sSet, unsigned int subscriberId){
+    acquireLock(&(sSet->writeLock));
+    for(unsigned int i = 0; i < sSet->typeCount; i++){
+        for(subscriberNode_t **link = &(getEventType(sSet, i)->subscribers); *link != NULL; link = &((*link)->next)){
+            if((*link)->id != subscriberId) continue;
+            subscriberNode_t *doomedSub = *link;
+            *link = doomedSub->next;
+            free(doomedSub);
+            subscriberSet_changed(sSet);
+            releaseLock(&(sSet->writeLock));
+            return 1;
+        }
+    }
+    releaseLock(&(sSet->writeLock));
+    // TODO: Standardize errors over all TPECS functions
+    fprintf(stderr, "Subscription %u could not be removed (no such subscription)\n", subscriberId);
+    return 0;
+}
+
+// Set how an event type's data is released when its events don't say otherwise
+// (e.g. releaseBorrowed for types whose payloads live in a frame arena)
+void setEventRelease(subscriberSet_t *sSet, unsigned int eventType, eventRelease_t release){
+    if(eventType < sSet->typeCount) getEventType(sSet, eventType)->release = release;
+}
+
+// Set an event type's dispatch priority: events of higher priority types go on their own FIFO
+// lane, which executors always drain before anything of lower priority
+void setEventPriority(subscriberSet_t *sSet, unsigned int eventType, unsigned int priority){
+    if(priority >= PRIORITY_LEVELS) priority = PRIORITY_LEVELS - 1;
+    if(eventType < sSet->typeCount) getEventType(sSet, eventType)->priority = priority;
+}
+
+// Make an event type's events start dispatch in the order they were published, by keeping
+// them on a FIFO lane rather than the LIFO stack and deques (higher priorities are always FIFO)
+void setEventOrdered(subscriberSet_t *sSet, unsigned int eventType, int ordered){
+    if(eventType < sSet->typeCount) getEventType(sSet, eventType)->ordered = ordered;
+}
+
+// Put an event type's events (and budget) on the given event stack shard, e.g. to give a
+// hot type a shard to itself, or to group types that are always published together
+void setEventShard(subscriberSet_t *sSet, unsigned int eventType, unsigned int shard){
+    if(eventType < sSet->typeCount && shard < EVENT_SHARDS) getEventType(sSet, eventType)->shard = shard;
+}
+
+// Give an event type a tick budget of its own, within its shard's (0 lifts it again)
+void setEventBudget(subscriberSet_t *sSet, unsigned int eventType, unsigned int budget){
+    if(eventType < sSet->typeCount) getEventType(sSet, eventType)->budget = budget;
+}
+
+// Make an event type coalesce: publishing one (COALESCE_TYPE), or one with the same key
+// (COALESCE_KEY), while another is pending makes no new event, but merges the new data into
+// the pending event's with the reducer (or just releases it, if that is NULL). An event stops
+// absorbing others once its dispatch starts. (Only safe between ticks; publishBatch never coalesces.)
+void setEventCoalescing(subscriberSet_t *sSet, unsigned int eventType, int coalesce, eventReducer_t reducer){
+    if(eventType >= sSet->typeCount) return;
+    getEventType(sSet, eventType)->coalesce = coalesce;
+    getEventType(sSet, eventType)->reducer = reducer;
+}
+
+// Let an event type's subscribers run in parallel: each event's subscriber list is split into
+// tasks of chunk subscribers, which idle workers can steal, and its data is released once the
+// last of them is done (0 restores running them all in turn on one worker). Safe at any time.
+void setEventFanout(subscriberSet_t *sSet, unsigned int eventType, unsigned int chunk){
+    acquireLock(&(sSet->writeLock));
+    if(eventType < sSet->typeCount){
+        getEventType(sSet, eventType)->fanout = chunk;
+        subscriberSet_changed(sSet);
+    }
+    releaseLock(&(sSet->writeLock));
+}
+
+
+
+// ========== NUMA PLACEMENT ==========
+// A thread's CPU affinity from before it was moved onto a node, to be put back afterwards
+typedef struct nodeAffinity{
+    int pinned;             // Nonzero if the thread was actually moved
+#ifdef __linux__
+    cpu_set_t previous;
+#endif
+} nodeAffinity_t;
+
+#ifdef __linux__
+// Read a sysfs list of IDs (such as "0-7,16-23") into a set; returns zero if it can't be read
+int numa_readList(const char *path, cpu_set_t *ids){
+    FILE *list = fopen(path, "r");
+    if(list == NULL) return 0;
+
+    CPU_ZERO(ids);
+    int first;
+    while(fscanf(list, "%d", &first) == 1){
+        int last = first;
+        int separator = fgetc(list);
+        if(separator == '-'){
+            if(fscanf(list, "%d", &last) != 1) break;
+            separator = fgetc(list);
+        }
+        for(int id = first; id <= last && id < CPU_SETSIZE; id++){
+            CPU_SET(id, ids);
+        }
+        if(separator != ',') break;
+    }
+    fclose(list);
+    return 1;
+}
+#endif
+
+// Count the machine's NUMA node IDs: one past the highest online node, as node IDs can be sparse
+// (1 where the topology can't be read; numa_nodeCpus says whether a given node exists)
+int numa_nodeCount(void){
+    int count = 0;
+#ifdef __linux__
+    cpu_set_t nodes;
+    if(numa_readList("/sys/devices/system/node/online", &nodes)){
+        for(int node = 0; node < CPU_SETSIZE; node++){
+            if(CPU_ISSET(node, &nodes)) count = node + 1;
+        }
+    }
+#endif
+    return (count == 0) ? 1 : count;
+}
+
+#ifdef __linux__
+// Read the CPUs belonging to a NUMA node (a cpulist such as "0-7,16-23"); returns zero if
+// the node doesn't exist (or has no CPUs)
+int numa_nodeCpus(int node, cpu_set_t *cpus){
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    return numa_readList(path, cpus) && CPU_COUNT(cpus) > 0;
+}
+#endif
+
+// Check whether a NUMA node exists with CPUs to run on (node 0 only, where the topology can't be read)
+int numa_nodeExists(int node){
+#ifdef __linux__
+    cpu_set_t cpus;
+    if(numa_nodeCpus(node, &cpus)) return 1;
+#endif
+    return node == 0 && numa_nodeCount() == 1;
+}
+
+// Move the calling thread onto a NUMA node's CPUs (so the memory it first touches comes from
+// that node, under Linux's default first-touch policy), saving its old affinity to restore.
+// A negative node, or one that doesn't exist, leaves the thread where it is.
+void numa_enterNode(int node, nodeAffinity_t *saved){
+    saved->pinned = 0;
+#ifdef __linux__
+    cpu_set_t cpus;
+    if(node < 0 || !numa_nodeCpus(node, &cpus)) return;
+    if(pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &(saved->previous))) return;
+    saved->pinned = !pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus);
+#endif
+}
+
+// Put the calling thread back where it was before numa_enterNode
+void numa_leaveNode(nodeAffinity_t *saved){
+#ifdef __linux__
+    if(saved->pinned) pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &(saved->previous));
+#endif
+    saved->pinned = 0;
+}
+
+
+
+// ========== SUBSCRIBER TIMING ==========
+#if PUBSUB_TIMING
+// A log-linear histogram of one subscriber's call times on one thread (HDR-style: HIST_SUB_BITS
+// of precision per power of two), written only by that thread, so merged by simple addition
+typedef struct subscriberHist{
+    atomic_ulong buckets[HIST_BUCKETS];
+    atomic_ulong count;           // Calls timed
+    atomic_ullong totalNanos;     // Their total time
+    atomic_ullong maxNanos;       // The longest of them
+} subscriberHist_t;
+
+// One thread's subscriber histograms, indexed by subscription ID
+typedef struct timingTable{
+    _Atomic(subscriberHist_t *) chunks[TIMING_CHUNKS]; // TIMING_CHUNK histograms each, allocated as needed
+    struct timingTable *next;                          // Linked List Link (all threads' tables)
+} timingTable_t;
+
+// Histograms merged over all threads (see subscriberTiming_merge)
+typedef struct histogram{
+    unsigned long buckets[HIST_BUCKETS];
+    unsigned long count;
+    unsigned long long totalNanos;
+    unsigned long long maxNanos;
+} histogram_t;
+
+timingTable_t *gTimingTables = NULL;
+pthread_mutex_t gTimingTablesLock = PTHREAD_MUTEX_INITIALIZER;
+
+// The calling thread's timing table (NULL until it first times a call)
+_Thread_local timingTable_t *tTimingTable = NULL;
+
+// Find the histogram bucket a time falls in
+unsigned int histogram_bucket(unsigned long long nanos){
+    if(nanos < (1u << HIST_SUB_BITS)) return (unsigned int)nanos;
+    unsigned int magnitude = 63 - __builtin_clzll(nanos);
+    unsigned int bucket = (magnitude - HIST_SUB_BITS + 1) * (1u << HIST_SUB_BITS) + (unsigned int)((nanos >> (magnitude - HIST_SUB_BITS)) & ((1u << HIST_SUB_BITS) - 1));
+    return (bucket < HIST_BUCKETS) ? bucket : HIST_BUCKETS - 1;
+}
+
+// Find the lowest time that falls in a histogram bucket
+unsigned long long histogram_bucketFloor(unsigned int bucket){
+    if(bucket < (1u << HIST_SUB_BITS)) return bucket;
+    unsigned int magnitude = bucket / (1u << HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+    return (1ULL << magnitude) | ((unsigned long long)(bucket % (1u << HIST_SUB_BITS)) << (magnitude - HIST_SUB_BITS));
+}
+
+// Estimate a merged histogram's given percentile, in per mille (the floor of its bucket)
+unsigned long long histogram_percentile(const histogram_t *hist, unsigned int perMille){
+    if(hist->count == 0) return 0;
+    unsigned long rank = (unsigned long)((hist->count - 1) * (unsigned long long)perMille / 1000);
+    unsigned long seen = 0;
+    for(unsigned int i = 0; i < HIST_BUCKETS; i++){
+        seen += hist->buckets[i];
+        if(seen > rank) return histogram_bucketFloor(i);
+    }
+    return hist->maxNanos;
+}
+
+// Record one call of a subscriber on the calling thread (plain loads and stores, as in statsAdd)
+void timingRecord(unsigned int subscriberId, unsigned long long nanos){
+    if(subscriberId / TIMING_CHUNK >= TIMING_CHUNKS) return;
+    timingTable_t *timingTable = tTimingTable;
+    if(timingTable == NULL){
+        timingTable = (timingTable_t *)calloc(1, sizeof(timingTable_t)); // Perhaps add error checking
+        acquireLock(&gTimingTablesLock);
+        timingTable->next = gTimingTables;
+        gTimingTables = timingTable;
+        releaseLock(&gTimingTablesLock);
+        tTimingTable = timingTable;
+    }
+
+    // Only this thread allocates its chunks, so no race to install them
+    _Atomic(subscriberHist_t *) *chunkSlot = &(timingTable->chunks[subscriberId / TIMING_CHUNK]);
+    subscriberHist_t *chunk = atomic_load_explicit(chunkSlot, memory_order_relaxed);
+    if(chunk == NULL){
+        chunk = (subscriberHist_t *)calloc(TIMING_CHUNK, sizeof(subscriberHist_t)); // Perhaps add error checking
+        atomic_store_explicit(chunkSlot, chunk, memory_order_release);
+    }
+
+    subscriberHist_t *hist = &(chunk[subscriberId % TIMING_CHUNK]);
+    atomic_ulong *bucket = &(hist->buckets[histogram_bucket(nanos)]);
+    atomic_store_explicit(bucket, atomic_load_explicit(bucket, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&(hist->count), atomic_load_explicit(&(hist->count), memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&(hist->totalNanos), atomic_load_explicit(&(hist->totalNanos), memory_order_relaxed) + nanos, memory_order_relaxed);
+    if(nanos > atomic_load_explicit(&(hist->maxNanos), memory_order_relaxed)) atomic_store_explicit(&(hist->maxNanos), nanos, memory_order_relaxed);
+}
+
+// Merge the first subscriberCount subscribers' histograms over all threads (out holds one each)
+void subscriberTiming_merge(unsigned int subscriberCount, histogram_t *out){
+    memset(out, 0, subscriberCount * sizeof(histogram_t));
+    acquireLock(&gTimingTablesLock);
+    for(timingTable_t *timingTable = gTimingTables; timingTable != NULL; timingTable = timingTable->next){
+        for(unsigned int c = 0; c * TIMING_CHUNK < subscriberCount && c < TIMING_CHUNKS; c++){
+            subscriberHist_t *chunk = atomic_load_explicit(&(timingTable->chunks[c]), memory_order_acquire);
+            if(chunk == NULL) continue;
+            for(unsigned int i = 0; i < TIMING_CHUNK && c * TIMING_CHUNK + i < subscriberCount; i++){
+                subscriberHist_t *hist = &(chunk[i]);
+                histogram_t *merged = &(out[c * TIMING_CHUNK + i]);
+                for(unsigned int b = 0; b < HIST_BUCKETS; b++){
+                    merged->buckets[b] += atomic_load_explicit(&(hist->buckets[b]), memory_order_relaxed);
+                }
+                merged->count += atomic_load_explicit(&(hist->count), memory_order_relaxed);
+                merged->totalNanos += atomic_load_explicit(&(hist->totalNanos), memory_order_relaxed);
+                unsigned long long maxNanos = atomic_load_explicit(&(hist->maxNanos), memory_order_relaxed);
+                if(maxNanos > merged->maxNanos) merged->maxNanos = maxNanos;
+            }
+        }
+    }
+    releaseLock(&gTimingTablesLock);
+}
+
+// A subscriber's place in the slowest-subscribers ranking
+typedef struct timingRank{
+    unsigned int id;
+    unsigned long long p99;
+    unsigned long long totalNanos;
+    unsigned int eventType;
+    subscriberFunction_t subscriberFunction;
+} timingRank_t;
+
+// Order ranks slowest (by p99, then by total time, then by subscription ID) first, for qsort
+int compareTimingRanks(const void *a, const void *b){
+    const timingRank_t *left = (const timingRank_t *)a;
+    const timingRank_t *right = (const timingRank_t *)b;
+    if(left->p99 != right->p99) return (left->p99 < right->p99) - (left->p99 > right->p99);
+    if(left->totalNanos != right->totalNanos) return (left->totalNanos < right->totalNanos) - (left->totalNanos > right->totalNanos);
+    return (left->id > right->id) - (left->id < right->id);
+}
+
+// Print the topN slowest subscribers (by p99 call time), with their call counts and times
+// (not to be called concurrently with subscribe)
+void subscriberTiming_dump(FILE *out, const subscriberSet_t *sSet, unsigned int topN){
+    unsigned int subscriberCount = sSet->subscriberCount;
+    if(subscriberCount == 0) return;
+    histogram_t *merged = (histogram_t *)malloc(subscriberCount * sizeof(histogram_t)); // Perhaps add error checking
+    subscriberTiming_merge(subscriberCount, merged);
+
+    // Rank every subscription that has been called
+    timingRank_t *ranks = (timingRank_t *)malloc(subscriberCount * sizeof(timingRank_t)); // Perhaps add error checking
+    unsigned int ranked = 0;
+    for(unsigned int t = 0; t < sSet->typeCount; t++){
+        for(subscriberNode_t *currentSub = getEventType(sSet, t)->subscribers; currentSub != NULL; currentSub = currentSub->next){
+            if(merged[currentSub->id].count == 0) continue;
+            ranks[ranked].id = currentSub->id;
+            ranks[ranked].p99 = histogram_percentile(&(merged[currentSub->id]), 990);
+            ranks[ranked].totalNanos = merged[currentSub->id].totalNanos;
+            ranks[ranked].eventType = t;
+            ranks[ranked].subscriberFunction = currentSub->subscriberFunction;
+            ranked++;
+        }
+    }
+    qsort(ranks, ranked, sizeof(timingRank_t), compareTimingRanks);
+
+    fprintf(out, "%-10s %-12s %-18s %10s %10s %10s %10s %10s %14s\n", "subscriber", "event type", "function", "calls", "mean ns", "p50 ns", "p99 ns", "max ns", "total ns");
+    for(unsigned int i = 0; i < ranked && i < topN; i++){
+        histogram_t *hist = &(merged[ranks[i].id]);
+        const char *typeName = getEventType(sSet, ranks[i].eventType)->name;
+        fprintf(out, "%-10u %-12s %-18p %10lu %10llu %10llu %10llu %10llu %14llu\n", ranks[i].id, (typeName != NULL) ? typeName : "(anonymous)",
+                (void *)ranks[i].subscriberFunction, hist->count, hist->totalNanos / hist->count, histogram_percentile(hist, 500), ranks[i].p99, hist->maxNanos, hist->totalNanos);
+    }
+    free(ranks);
+    free(merged);
+}
+
+// Deallocate every thread's timing table (only once no subscribers are running)
+void subscriberTiming_destroy(void){
+    acquireLock(&gTimingTablesLock);
+    while(gTimingTables != NULL){
+        timingTable_t *doomedTable = gTimingTables;
+        gTimingTables = doomedTable->next;
+        for(int i = 0; i < TIMING_CHUNKS; i++){
+            free(atomic_load(&(doomedTable->chunks[i])));
+        }
+        free(doomedTable);
+    }
+    releaseLock(&gTimingTablesLock);
+}
+#endif
+
+
+
+// ========== EVENT DEFINITIONS ==========
+// An event
+typedef struct eventNode{
+    unsigned int type;      // The event's type
+    unsigned int flags;     // EVENT_* flags below
+    void *data;             // The event-type-specific data associated with this event
+    eventRelease_t release; // How data is released (NULL: the event type's default)
+    struct eventNode *next; // Linked List Link
+    unsigned long long coalesceKey;  // The key it coalesces under (while EVENT_COALESCING)
+    struct eventNode *coalesceNext;  // Linked List Link (its coalescing bucket's pending events)
+    unsigned long long timerDue;     // When it falls due, in its timing wheel's units (while deferred)
+    atomic_uint fanoutRefs;          // Subscriber ranges still running (while fanned out)
+    unsigned int taskBegin;          // A fan-out task's subscriber range, in its type's dispatch table
+    unsigned int taskEnd;
+    struct eventNode *fanoutParent;  // The event a fan-out task runs subscribers of
+    const dispatchTable_t *taskTable; // The dispatch table its range is in
+    union {
+        max_align_t align;
+        unsigned char bytes[EVENT_INLINE_BYTES];
+    } inlineData;           // Storage for small payloads (see publishInline)
+#if EVENT_ALLOCATOR == EVENT_ALLOCATOR_SLAB
+    struct eventCache *owner; // The cache this node's slab belongs to
+#endif
+#if PUBSUB_TRACE
+    unsigned long long traceId;          // The event's trace ID (0 if it isn't traced)
+    unsigned long long traceParent;      // The traced event being dispatched when it was published (0 for none)
+    unsigned long long tracePublishedAt; // nowNanos() when it was published
+    int tracePublisher;                  // The worker that published it (-1 for a non-executor thread)
+#endif
+} event_t;
+
+#define EVENT_DATA_INLINE 0x1 // The event's data points into its own inlineData (released as borrowed)
+#define EVENT_COALESCING 0x2  // The event is pending in its stack's coalescing table, absorbing others
+#define EVENT_FANOUT_TASK 0x4 // Not an event, but a range of its fanoutParent's subscribers to run
+
+// Release an event's data, as the event or else its type says (inline data lives and dies
+// with the event, so is never released on its own, whatever its release says)
+void releaseEventData(const subscriberSet_t *sSet, event_t *event){
+    if(event->data == NULL || (event->flags & EVENT_DATA_INLINE)) return;
+    eventRelease_t release = event->release;
+    if(release == NULL) release = (event->type < sSet->typeCount) ? getEventType(sSet, event->type)->release : free;
+    release(event->data);
+}
+
+
+
+// ========== EVENT NODE ALLOCATION ==========
+#if EVENT_ALLOCATOR == EVENT_ALLOCATOR_SLAB
+// A fixed-size block of event nodes, all handed out by the same cache
+typedef struct eventSlab{
+    _Alignas(CACHE_LINE_SIZE) struct eventSlab *next; // Linked List Link (for final deallocation)
+    event_t nodes[EVENT_SLAB_SIZE];
+} eventSlab_t;
+
+// A thread's cache of free event nodes, carved from slabs it owns
+// (nodes freed by other threads come home through the lock-free remoteFree list, which
+//  only the owner ever empties, and does so all at once, so it is immune to ABA)
+typedef struct eventCache{
+    event_t *freeList;                                         // Nodes ready for reuse (owner only)
+    eventSlab_t *slabs;                                        // Every slab this cache has carved
+    _Alignas(CACHE_LINE_SIZE) _Atomic(event_t *) remoteFree;   // Nodes freed by other threads
+} eventCache_t;
+
+// All event node caches: one per thread up to EVENT_CACHE_SLOTS, then one shared by the rest
+typedef struct eventAllocator{
+    eventCache_t caches[EVENT_CACHE_SLOTS];
+    atomic_uchar cacheOwned[EVENT_CACHE_SLOTS]; // Nonzero while a thread has the cache
+    atomic_uint cachesClaimed;    // Caches ever used (caches are given back as threads exit)
+    eventCache_t shared;          // Used by threads beyond the slots, under sharedLock
+    pthread_mutex_t sharedLock;
+} eventAllocator_t;
+
+eventAllocator_t gEventAllocator = { .sharedLock = PTHREAD_MUTEX_INITIALIZER };
+
+// The calling thread's event node cache (NULL until its first allocation or free)
+_Thread_local eventCache_t *tEventCache = NULL;
+
+// Carve a fresh slab into a cache's free list
+void eventCache_grow(eventCache_t *cache){
+    eventSlab_t *slab = (eventSlab_t *)aligned_alloc(CACHE_LINE_SIZE, sizeof(eventSlab_t)); // Perhaps add error checking
+    slab->next = cache->slabs;
+    cache->slabs = slab;
+    for(int i = 0; i < EVENT_SLAB_SIZE; i++){
+        slab->nodes[i].owner = cache;
+        slab->nodes[i].next = cache->freeList;
+        cache->freeList = &(slab->nodes[i]);
+    }
+}
+
+// Claim the calling thread's cache, pre-sized so a tick's worth of events needs no more slabs
+// (a cache given back by an exited thread is taken over as it is, its nodes and slabs included)
+eventCache_t *claimEventCache(void){
+    unsigned int slot = claimThreadSlot(gEventAllocator.cacheOwned, EVENT_CACHE_SLOTS, &(gEventAllocator.cachesClaimed));
+    if(slot >= EVENT_CACHE_SLOTS){
+        tEventCache = &(gEventAllocator.shared);
+    } else {
+        tEventCache = &(gEventAllocator.caches[slot]);
+        if(tEventCache->slabs == NULL) eventCache_grow(tEventCache);
+    }
+    return tEventCache;
+}
+
+// Give the calling thread its cache up front, rather than on its first allocation
+void eventAllocator_prepareThread(void){
+    if(tEventCache == NULL) claimEventCache();
+}
+
+// Give the calling thread's cache back as it exits, for the next thread to take over (nodes
+// still out on other threads come home to it through its remote free list as before)
+void eventAllocator_releaseThread(void){
+    if(tEventCache != NULL && tEventCache != &(gEventAllocator.shared)) releaseThreadSlot(gEventAllocator.cacheOwned, (unsigned int)(tEventCache - gEventAllocator.caches));
+    tEventCache = NULL;
+}
+
+// Take a node from a cache, collecting remotely freed nodes (and finally growing) when it runs dry
+event_t *eventCache_take(eventCache_t *cache){
+    if(cache->freeList == NULL){
+        cache->freeList = atomic_exchange(&(cache->remoteFree), NULL);
+        if(cache->freeList == NULL) eventCache_grow(cache);
+    }
+    event_t *node = cache->freeList;
+    cache->freeList = node->next;
+    return node;
+}
+
+// Allocate an event node from the calling thread's cache
+event_t *allocEvent(void){
+    eventCache_t *cache = tEventCache;
+    if(cache == NULL) cache = claimEventCache();
+    if(cache != &(gEventAllocator.shared)) return eventCache_take(cache);
+
+    acquireLock(&(gEventAllocator.sharedLock));
+    event_t *node = eventCache_take(cache);
+    releaseLock(&(gEventAllocator.sharedLock));
+    return node;
+}
+
+// Return an event node to the cache that owns it
+void freeEvent(event_t *event){
+    eventCache_t *owner = event->owner;
+    if(owner == tEventCache && owner != &(gEventAllocator.shared)){
+        // Our own node: straight back on our free list
+        event->next = owner->freeList;
+        owner->freeList = event;
+    } else {
+        // Someone else's: hand it back through their remote free list
+        event_t *head = atomic_load_explicit(&(owner->remoteFree), memory_order_relaxed);
+        do {
+            event->next = head;
+        } while(!atomic_compare_exchange_weak_explicit(&(owner->remoteFree), &head, event, memory_order_release, memory_order_relaxed));
+    }
+}
+
+// Deallocate every slab (only once no event nodes are live anywhere)
+void eventAllocator_destroy(void){
+    unsigned int claimed = atomic_load(&(gEventAllocator.cachesClaimed));
+    if(claimed > EVENT_CACHE_SLOTS) claimed = EVENT_CACHE_SLOTS;
+    for(unsigned int i = 0; i <= claimed; i++){
+        // (the shared cache goes last)
+        eventCache_t *cache = (i == claimed) ? &(gEventAllocator.shared) : &(gEventAllocator.caches[i]);
+        while(cache->slabs != NULL){
+            eventSlab_t *doomedSlab = cache->slabs;
+            cache->slabs = doomedSlab->next;
+            free(doomedSlab);
+        }
+        cache->freeList = NULL;
+        atomic_store(&(cache->remoteFree), NULL);
+    }
+}
+#else
+// Allocate an event node straight from the heap
+event_t *allocEvent(void){
+    return (event_t *)malloc(sizeof(event_t)); // Perhaps add error checking
+}
+
+// Return an event node to the heap
+void freeEvent(event_t *event){
+    free(event);
+}
+
+// Nothing to prepare with the heap allocator
+void eventAllocator_prepareThread(void){
+}
+
+// Nothing to give back with the heap allocator
+void eventAllocator_releaseThread(void){
+}
+
+// Nothing to deallocate with the heap allocator
+void eventAllocator_destroy(void){
+}
+#endif
+
+
+
+
+// A bounded lock-free multi-producer/multi-consumer ring of events
+// (after Dmitry Vyukov's design: each slot's sequence number says whose turn it is,
+//  so producers and consumers only ever contend on their own position counter)
+typedef struct eventRingSlot{
+    atomic_size_t sequence; // Equals the slot's position when free, position + 1 when filled
+    event_t *event;         // The queued event
+} eventRingSlot_t;
+
+typedef struct eventRing{
+    eventRingSlot_t *slots;
+    size_t mask;                                         // Capacity - 1 (capacity is a power of two)
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t enqueuePos;  // Next position to fill
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t dequeuePos;  // Next position to empty
+} eventRing_t;
+
+// Initialize an event ring with the given (power of two) capacity
+void eventRing_init(eventRing_t *ring, size_t capacity){
+    ring->slots = (eventRingSlot_t *)malloc(capacity * sizeof(eventRingSlot_t)); // Perhaps add error checking
+    ring->mask = capacity - 1;
+    for(size_t i = 0; i < capacity; i++){
+        atomic_init(&(ring->slots[i].sequence), i);
+        ring->slots[i].event = NULL;
+    }
+    atomic_init(&(ring->enqueuePos), 0);
+    atomic_init(&(ring->dequeuePos), 0);
+}
+
+// Append an event to an event ring; returns zero if the ring is full
+int eventRing_push(eventRing_t *ring, event_t *event){
+    size_t pos = atomic_load_explicit(&(ring->enqueuePos), memory_order_relaxed);
+    while(1){
+        eventRingSlot_t *slot = &(ring->slots[pos & ring->mask]);
+        size_t seq = atomic_load_explicit(&(slot->sequence), memory_order_acquire);
+        if(seq == pos){
+            // Slot is free this lap; try to claim it
+            if(atomic_compare_exchange_weak(&(ring->enqueuePos), &pos, pos + 1)){
+                slot->event = event;
+                atomic_store_explicit(&(slot->sequence), pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if(seq < pos){
+            // Slot still holds last lap's event: the ring is full
+            return 0;
+        } else {
+            // Another producer got here first
+            pos = atomic_load_explicit(&(ring->enqueuePos), memory_order_relaxed);
+        }
+    }
+}
+
+// Remove and return the oldest event from an event ring (NULL if it is empty)
+event_t *eventRing_pop(eventRing_t *ring){
+    size_t pos = atomic_load_explicit(&(ring->dequeuePos), memory_order_relaxed);
+    while(1){
+        eventRingSlot_t *slot = &(ring->slots[pos & ring->mask]);
+        size_t seq = atomic_load_explicit(&(slot->sequence), memory_order_acquire);
+        if(seq == pos + 1){
+            // Slot is filled; try to claim it
+            if(atomic_compare_exchange_weak(&(ring->dequeuePos), &pos, pos + 1)){
+                event_t *event = slot->event;
+                atomic_store_explicit(&(slot->sequence), pos + ring->mask + 1, memory_order_release);
+                return event;
+            }
+        } else if(seq < pos + 1){
+            // Slot not yet filled: the ring is empty
+            return NULL;
+        } else {
+            // Another consumer got here first
+            pos = atomic_load_explicit(&(ring->dequeuePos), memory_order_relaxed);
+        }
+    }
+}
+
+// Check whether an event ring holds no events (or only ones still being pushed)
+int eventRing_isEmpty(eventRing_t *ring){
+    return atomic_load(&(ring->dequeuePos)) >= atomic_load(&(ring->enqueuePos));
+}
+
+// Estimate how many events an event ring holds (without synchronizing)
+unsigned int eventRing_depth(eventRing_t *ring){
+    size_t enqueued = atomic_load_explicit(&(ring->enqueuePos), memory_order_relaxed);
+    size_t dequeued = atomic_load_explicit(&(ring->dequeuePos), memory_order_relaxed);
+    return (enqueued > dequeued) ? (unsigned int)(enqueued - dequeued) : 0;
+}
+
+// Deallocate an event ring's slots
+void eventRing_destroy(eventRing_t *ring){
+    free(ring->slots);
+}
+
+// A copy of an event forwarded from another bus, as it waits in an inbox
+typedef struct forwardedEvent{
+    unsigned int type;
+    unsigned int length;                     // Payload bytes
+    void *data;                              // A heap copy of the payload, if over EVENT_INLINE_BYTES (else NULL)
+    unsigned char bytes[EVENT_INLINE_BYTES]; // Otherwise the payload itself
+} forwardedEvent_t;
+
+typedef struct forwardSlot{
+    atomic_size_t sequence; // Equals the slot's position when free, position + 1 when filled
+    forwardedEvent_t event;
+} forwardSlot_t;
+
+// A bounded lock-free MPMC ring of events forwarded to a stack from other buses (laid out as
+// eventRing_t, but holding copies rather than event nodes: the stack's own executors make the
+// nodes as they take them in, so the nodes are theirs, on their NUMA node)
+typedef struct forwardInbox{
+    forwardSlot_t *slots;
+    size_t mask;                                         // Capacity - 1 (capacity is a power of two)
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t enqueuePos;  // Next position to fill
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t dequeuePos;  // Next position to empty
+} forwardInbox_t;
+
+// Initialize a forwarding inbox with the given (power of two) capacity
+void forwardInbox_init(forwardInbox_t *inbox, size_t capacity){
+    inbox->slots = (forwardSlot_t *)malloc(capacity * sizeof(forwardSlot_t)); // Perhaps add error checking
+    inbox->mask = capacity - 1;
+    for(size_t i = 0; i < capacity; i++){
+        atomic_init(&(inbox->slots[i].sequence), i);
+    }
+    atomic_init(&(inbox->enqueuePos), 0);
+    atomic_init(&(inbox->dequeuePos), 0);
+}
+
+// Append a copy of an event to a forwarding inbox; returns zero if the inbox is full
+int forwardInbox_push(forwardInbox_t *inbox, unsigned int eventType, const void *src, size_t len){
+    size_t pos = atomic_load_explicit(&(inbox->enqueuePos), memory_order_relaxed);
+    while(1){
+        forwardSlot_t *slot = &(inbox->slots[pos & inbox->mask]);
+        size_t seq = atomic_load_explicit(&(slot->sequence), memory_order_acquire);
+        if(seq == pos){
+            // Slot is free this lap; try to claim it
+            if(atomic_compare_exchange_weak(&(inbox->enqueuePos), &pos, pos + 1)){
+                slot->event.type = eventType;
+                slot->event.length = (unsigned int)len;
+                if(len <= EVENT_INLINE_BYTES){
+                    slot->event.data = NULL;
+                    memcpy(slot->event.bytes, src, len);
+                } else {
+                    slot->event.data = malloc(len); // Perhaps add error checking
+                    memcpy(slot->event.data, src, len);
+                }
+                atomic_store_explicit(&(slot->sequence), pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if(seq < pos){
+            // Slot still holds last lap's event: the inbox is full
+            return 0;
+        } else {
+            // Another producer got here first
+            pos = atomic_load_explicit(&(inbox->enqueuePos), memory_order_relaxed);
+        }
+    }
+}
+
+// Remove the oldest event from a forwarding inbox into out; returns zero if it is empty
+int forwardInbox_pop(forwardInbox_t *inbox, forwardedEvent_t *out){
+    size_t pos = atomic_load_explicit(&(inbox->dequeuePos), memory_order_relaxed);
+    while(1){
+        forwardSlot_t *slot = &(inbox->slots[pos & inbox->mask]);
+        size_t seq = atomic_load_explicit(&(slot->sequence), memory_order_acquire);
+        if(seq == pos + 1){
+            // Slot is filled; try to claim it
+            if(atomic_compare_exchange_weak(&(inbox->dequeuePos), &pos, pos + 1)){
+                *out = slot->event;
+                atomic_store_explicit(&(slot->sequence), pos + inbox->mask + 1, memory_order_release);
+                return 1;
+            }
+        } else if(seq < pos + 1){
+            // Slot not yet filled: the inbox is empty
+            return 0;
+        } else {
+            // Another consumer got here first
+            pos = atomic_load_explicit(&(inbox->dequeuePos), memory_order_relaxed);
+        }
+    }
+}
+
+// Check whether a forwarding inbox holds no events (or only ones still being pushed)
+int forwardInbox_isEmpty(forwardInbox_t *inbox){
+    return atomic_load(&(inbox->dequeuePos)) >= atomic_load(&(inbox->enqueuePos));
+}
+
+// Deallocate a forwarding inbox, and the heap copies of any events still in it
+void forwardInbox_destroy(forwardInbox_t *inbox){
+    forwardedEvent_t leftover;
+    while(forwardInbox_pop(inbox, &leftover)){
+        free(leftover.data);
+    }
+    free(inbox->slots);
+}
+
+
+// A fixed-capacity work-stealing deque of events, one per executor
+// (after Chase & Lev, with the C11 orderings of Le et al.: the owning executor pushes and
+//  pops at the bottom without contention, idle peers steal from the top)
+typedef struct workerDeque{
+    _Atomic(event_t *) *buffer;                    // Circular buffer of queued events
+    long mask;                                     // Capacity - 1 (capacity is a power of two)
+    _Alignas(CACHE_LINE_SIZE) atomic_long top;     // Next event to be stolen
+    _Alignas(CACHE_LINE_SIZE) atomic_long bottom;  // Next free slot for the owner
+} workerDeque_t;
+
+// Initialize a work-stealing deque with the given (power of two) capacity
+void workerDeque_init(workerDeque_t *deque, long capacity){
+    deque->buffer = (_Atomic(event_t *) *)malloc(capacity * sizeof(_Atomic(event_t *))); // Perhaps add error checking
+    deque->mask = capacity - 1;
+    for(long i = 0; i < capacity; i++){
+        atomic_init(&(deque->buffer[i]), NULL);
+    }
+    atomic_init(&(deque->top), 0);
+    atomic_init(&(deque->bottom), 0);
+}
+
+// Push an event onto the bottom of a deque (owner only); returns zero if the deque is full
+int workerDeque_push(workerDeque_t *deque, event_t *event){
+    long b = atomic_load_explicit(&(deque->bottom), memory_order_relaxed);
+    long t = atomic_load_explicit(&(deque->top), memory_order_acquire);
+    if(b - t > deque->mask) return 0;
+    atomic_store_explicit(&(deque->buffer[b & deque->mask]), event, memory_order_relaxed);
+    atomic_store_explicit(&(deque->bottom), b + 1, memory_order_release);
+    return 1;
+}
+
+// Pop the most recently pushed event from the bottom of a deque (owner only)
+event_t *workerDeque_pop(workerDeque_t *deque){
+    long b = atomic_load_explicit(&(deque->bottom), memory_order_relaxed) - 1;
+    atomic_store_explicit(&(deque->bottom), b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&(deque->top), memory_order_relaxed);
+
+    event_t *event = NULL;
+    if(t <= b){
+        event = atomic_load_explicit(&(deque->buffer[b & deque->mask]), memory_order_relaxed);
+        if(t == b){
+            // Last event: race any thieves for it
+            if(!atomic_compare_exchange_strong_explicit(&(deque->top), &t, t + 1, memory_order_seq_cst, memory_order_relaxed)){
+                event = NULL;
+            }
+            atomic_store_explicit(&(deque->bottom), b + 1, memory_order_relaxed);
+        }
+    } else {
+        // Deque was empty
+        atomic_store_explicit(&(deque->bottom), b + 1, memory_order_relaxed);
+    }
+    return event;
+}
+
+// Steal the oldest event from the top of a deque (any thread); NULL if empty or lost to a race
+event_t *workerDeque_steal(workerDeque_t *deque){
+    long t = atomic_load_explicit(&(deque->top), memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&(deque->bottom), memory_order_acquire);
+    if(t >= b) return NULL;
+
+    event_t *event = atomic_load_explicit(&(deque->buffer[t & deque->mask]), memory_order_relaxed);
+    if(!atomic_compare_exchange_strong_explicit(&(deque->top), &t, t + 1, memory_order_seq_cst, memory_order_relaxed)){
+        return NULL;
+    }
+    return event;
+}
+
+// Check whether a deque holds no events
+int workerDeque_isEmpty(workerDeque_t *deque){
+    return atomic_load(&(deque->top)) >= atomic_load(&(deque->bottom));
+}
+
+// Deallocate a deque's buffer
+void workerDeque_destroy(workerDeque_t *deque){
+    free(deque->buffer);
+}
+
+
+// An executor thread's own state
+typedef struct executorWorker{
+    workerDeque_t deque;            // Events published by subscribers running on this worker
+    struct eventStack *eventStack;  // The stack this worker serves
+    struct executorPool *pool;      // The pool this worker belongs to
+    int id;                         // Index of this worker within its pool
+} executorWorker_t;
+
+// The executor running on the calling thread (NULL on non-executor threads)
+_Thread_local executorWorker_t *tCurrentWorker = NULL;
+
+// Where a subscriber's publishes go: the stack it is being run for, and the worker running it
+// (so they can go straight onto that worker's deque)
+struct publisher{
+    struct eventStack *eventStack;
+    executorWorker_t *worker;
+};
+
+#if PUBSUB_TRACE
+// One traced event's life, as recorded by the worker that dispatched it
+typedef struct traceEntry{
+    unsigned long long id;          // The event's trace ID
+    unsigned long long parentId;    // The trace ID of the event whose subscriber published it (0 for none)
+    unsigned long long publishedAt; // nowNanos() when it was published
+    unsigned long long startedAt;   // ... when its dispatch started
+    unsigned long long endedAt;     // ... and ended
+    unsigned int type;              // The event's type
+    int publisherWorker;            // The worker that published it (-1 for a non-executor thread)
+    int worker;                     // The worker that dispatched it
+} traceEntry_t;
+
+// One thread's trace: a ring of its most recent TRACE_RING_ENTRIES dispatches
+typedef struct traceRing{
+    traceEntry_t entries[TRACE_RING_ENTRIES];
+    atomic_ulong written;             // Entries ever written (the next goes at written % TRACE_RING_ENTRIES)
+    unsigned long long nextId;        // The last trace ID handed out by this thread
+    unsigned long long idBase;        // This thread's trace ID space (its ring's index, shifted)
+    unsigned int rootsSeen;           // Untraced root events published, towards the next sample
+    struct traceRing *next;           // Linked List Link (all threads' rings)
+} traceRing_t;
+
+atomic_uint gTraceSampleEvery;        // 0 while not tracing, else one root event in this many is traced
+traceRing_t *gTraceRings = NULL;
+unsigned int gTraceRingCount = 0;
+atomic_uint gTraceGeneration;         // Bumped by trace_destroy, so threads know their rings are gone
+pthread_mutex_t gTraceRingsLock = PTHREAD_MUTEX_INITIALIZER;
+
+// The calling thread's trace ring (NULL until it first traces) and the generation it belongs
+// to, and the traced event it is dispatching (0 if none)
+_Thread_local traceRing_t *tTraceRing = NULL;
+_Thread_local unsigned int tTraceGeneration = 0;
+_Thread_local unsigned long long tTraceParent = 0;
+
+// Find the calling thread's trace ring, claiming one on first use (or first use since trace_destroy)
+traceRing_t *traceRing(void){
+    traceRing_t *ring = tTraceRing;
+    unsigned int generation = atomic_load_explicit(&gTraceGeneration, memory_order_acquire);
+    if(ring == NULL || tTraceGeneration != generation){
+        ring = (traceRing_t *)calloc(1, sizeof(traceRing_t)); // Perhaps add error checking
+        acquireLock(&gTraceRingsLock);
+        ring->idBase = (unsigned long long)(++gTraceRingCount) << 40;
+        ring->next = gTraceRings;
+        gTraceRings = ring;
+        releaseLock(&gTraceRingsLock);
+        tTraceRing = ring;
+        tTraceGeneration = generation;
+    }
+    return ring;
+}
+
+// Start tracing: one in sampleEvery events published from outside any subscriber is traced,
+// along with everything published while dispatching a traced event (so whole cascades are kept)
+void trace_start(unsigned int sampleEvery){
+    atomic_store(&gTraceSampleEvery, (sampleEvery == 0) ? 1 : sampleEvery);
+}
+
+// Stop tracing (events already being traced still are, until dispatched)
+void trace_stop(void){
+    atomic_store(&gTraceSampleEvery, 0);
+}
+
+// Decide whether a newly published event is traced, and if so stamp it
+void traceEventPublished(event_t *event){
+    event->traceId = 0;
+    unsigned int sampleEvery = atomic_load_explicit(&gTraceSampleEvery, memory_order_relaxed);
+    if(sampleEvery == 0) return;
+
+    traceRing_t *ring = traceRing();
+    unsigned long long parentId = tTraceParent;
+    if(parentId == 0 && ++(ring->rootsSeen) < sampleEvery) return;
+    if(parentId == 0) ring->rootsSeen = 0;
+
+    event->traceId = ring->idBase | ++(ring->nextId);
+    event->traceParent = parentId;
+    event->tracePublishedAt = nowNanos();
+    event->tracePublisher = (tCurrentWorker != NULL) ? tCurrentWorker->id : -1;
+}
+
+// Record a traced event's dispatch on the calling thread's ring
+void traceEventDispatched(const event_t *event, int worker, unsigned long long startedAt, unsigned long long endedAt){
+    traceRing_t *ring = traceRing();
+    unsigned long written = atomic_load_explicit(&(ring->written), memory_order_relaxed);
+    traceEntry_t *entry = &(ring->entries[written % TRACE_RING_ENTRIES]);
+    entry->id = event->traceId;
+    entry->parentId = event->traceParent;
+    entry->publishedAt = event->tracePublishedAt;
+    entry->startedAt = startedAt;
+    entry->endedAt = endedAt;
+    entry->type = event->type;
+    entry->publisherWorker = event->tracePublisher;
+    entry->worker = worker;
+    atomic_store_explicit(&(ring->written), written + 1, memory_order_release);
+}
+
+// Write every thread's traced dispatches out as Chrome trace / Perfetto JSON: one slice per
+// dispatch on its worker's track, and a flow arrow from each publish to the dispatch it caused
+// (only while nothing is being dispatched, e.g. between ticks)
+void trace_export(FILE *out, const subscriberSet_t *sSet){
+    acquireLock(&gTraceRingsLock);
+
+    // Timestamps are given relative to the earliest publish
+    unsigned long long origin = ~0ULL;
+    int maxWorker = -1;
+    for(traceRing_t *ring = gTraceRings; ring != NULL; ring = ring->next){
+        unsigned long written = atomic_load_explicit(&(ring->written), memory_order_acquire);
+        for(unsigned long i = (written > TRACE_RING_ENTRIES) ? written - TRACE_RING_ENTRIES : 0; i < written; i++){
+            traceEntry_t *entry = &(ring->entries[i % TRACE_RING_ENTRIES]);
+            if(entry->publishedAt < origin) origin = entry->publishedAt;
+            if(entry->worker > maxWorker) maxWorker = entry->worker;
+        }
+    }
+
+    // Track 0 is for non-executor threads, track n + 1 for worker n
+    fprintf(out, "{\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"publishers\"}}");
+    for(int i = 0; i <= maxWorker; i++){
+        fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}", i + 1, i);
+    }
+    for(traceRing_t *ring = gTraceRings; ring != NULL; ring = ring->next){
+        unsigned long written = atomic_load_explicit(&(ring->written), memory_order_acquire);
+        for(unsigned long i = (written > TRACE_RING_ENTRIES) ? written - TRACE_RING_ENTRIES : 0; i < written; i++){
+            traceEntry_t *entry = &(ring->entries[i % TRACE_RING_ENTRIES]);
+            const char *typeName = (entry->type < sSet->typeCount) ? getEventType(sSet, entry->type)->name : NULL;
+            fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"event\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"type\":%u,\"id\":%llu,\"parent\":%llu,\"queued_us\":%.3f}}",
+                    (typeName != NULL) ? typeName : "(anonymous)", entry->worker + 1, (entry->startedAt - origin) / 1e3, (entry->endedAt - entry->startedAt) / 1e3,
+                    entry->type, entry->id, entry->parentId, (entry->startedAt - entry->publishedAt) / 1e3);
+            // The flow starts where the event was published (inside its parent's slice, if any)
+            fprintf(out, ",\n{\"name\":\"publish\",\"cat\":\"flow\",\"ph\":\"s\",\"id\":%llu,\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                    entry->id, entry->publisherWorker + 1, (entry->publishedAt - origin) / 1e3);
+            fprintf(out, ",\n{\"name\":\"publish\",\"cat\":\"flow\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%llu,\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                    entry->id, entry->worker + 1, (entry->startedAt - origin) / 1e3);
+        }
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+    releaseLock(&gTraceRingsLock);
+}
+
+// Deallocate every thread's trace ring (only once nothing is being published or dispatched);
+// tracing can be started again afterwards, each thread then taking a fresh ring
+void trace_destroy(void){
+    acquireLock(&gTraceRingsLock);
+    while(gTraceRings != NULL){
+        traceRing_t *doomedRing = gTraceRings;
+        gTraceRings = doomedRing->next;
+        free(doomedRing);
+    }
+    atomic_fetch_add_explicit(&gTraceGeneration, 1, memory_order_release);
+    releaseLock(&gTraceRingsLock);
+}
+#endif
+
+
+
+// A hierarchical timing wheel of deferred events: TIMER_LEVELS levels of TIMER_SLOTS slots,
+// level l's slots each spanning TIMER_SLOTS^l time units. An event goes on the lowest level
+// whose current span holds its due time, so inserting is O(1), and as time reaches each slot
+// its events cascade down a level (at most TIMER_LEVELS times each) until they fall due.
+// Occupancy bitmaps let time jump straight to the next occupied slot, however far off.
+typedef struct timerWheel{
+    event_t *slots[TIMER_LEVELS][TIMER_SLOTS];  // Linked Lists (through next) of events, by level and slot
+    unsigned long long occupied[TIMER_LEVELS];  // Bit s set if slots[l][s] is not empty
+    event_t *overflow;                          // Events due beyond the top level's current span
+    unsigned long long now;                     // The wheel's time: everything due by now has been taken out
+    unsigned int count;                         // Events in the wheel
+} timerWheel_t;
+
+// Initialize an empty timing wheel starting at the given time
+void timerWheel_init(timerWheel_t *wheel, unsigned long long now){
+    memset(wheel, 0, sizeof(timerWheel_t));
+    wheel->now = now;
+}
+
+// Put an event (due after the wheel's time) on the lowest level whose span holds its due time
+void timerWheel_place(timerWheel_t *wheel, event_t *event){
+    for(int level = 0; level < TIMER_LEVELS; level++){
+        unsigned int spanShift = TIMER_SLOT_BITS * (level + 1);
+        if((event->timerDue >> spanShift) == (wheel->now >> spanShift)){
+            unsigned int slot = (unsigned int)(event->timerDue >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1);
+            event->next = wheel->slots[level][slot];
+            wheel->slots[level][slot] = event;
+            wheel->occupied[level] |= 1ULL << slot;
+            return;
+        }
+    }
+    event->next = wheel->overflow;
+    wheel->overflow = event;
+}
+
+// Move a list of the wheel's events down to where they now belong, or onto the due chain
+void timerWheel_replace(timerWheel_t *wheel, event_t *event, event_t **due){
+    while(event != NULL){
+        event_t *next = event->next;
+        if(event->timerDue <= wheel->now){
+            event->next = *due;
+            *due = event;
+            wheel->count--;
+        } else {
+            timerWheel_place(wheel, event);
+        }
+        event = next;
+    }
+}
+
+// Empty one slot, as time reaches it
+void timerWheel_cascade(timerWheel_t *wheel, int level, unsigned int slot, event_t **due){
+    if(!(wheel->occupied[level] & (1ULL << slot))) return;
+    event_t *event = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~(1ULL << slot);
+    timerWheel_replace(wheel, event, due);
+}
+
+// Find the next time after the wheel's at which one of its slots (or the overflow) needs
+// emptying; ULLONG_MAX if it is empty
+unsigned long long timerWheel_nextTime(const timerWheel_t *wheel){
+    unsigned long long next = ULLONG_MAX;
+    for(int level = 0; level < TIMER_LEVELS; level++){
+        unsigned int slotShift = TIMER_SLOT_BITS * level;
+        unsigned int current = (unsigned int)(wheel->now >> slotShift) & (TIMER_SLOTS - 1);
+        unsigned long long later = (current == TIMER_SLOTS - 1) ? 0 : wheel->occupied[level] & (~0ULL << (current + 1));
+        if(later == 0) continue;
+        unsigned long long spanStart = (wheel->now >> (slotShift + TIMER_SLOT_BITS)) << (slotShift + TIMER_SLOT_BITS);
+        unsigned long long slotStart = spanStart | ((unsigned long long)__builtin_ctzll(later) << slotShift);
+        if(slotStart < next) next = slotStart;
+    }
+    if(wheel->overflow != NULL){
+        unsigned int topShift = TIMER_SLOT_BITS * TIMER_LEVELS;
+        unsigned long long nextSpan = ((wheel->now >> topShift) + 1) << topShift;
+        if(nextSpan < next) next = nextSpan;
+    }
+    return next;
+}
+
+// Move the wheel's time on to target, chaining every event due by then onto due
+void timerWheel_advance(timerWheel_t *wheel, unsigned long long target, event_t **due){
+    while(wheel->count > 0){
+        unsigned long long next = timerWheel_nextTime(wheel);
+        if(next > target) break;
+        wheel->now = next;
+
+        // Empty every slot starting now, from the top down, so cascaded events can land in
+        // the lower slots still to be emptied
+        unsigned int topShift = TIMER_SLOT_BITS * TIMER_LEVELS;
+        if((wheel->now & ((1ULL << topShift) - 1)) == 0){
+            event_t *overflow = wheel->overflow;
+            wheel->overflow = NULL;
+            timerWheel_replace(wheel, overflow, due);
+        }
+        for(int level = TIMER_LEVELS - 1; level >= 0; level--){
+            unsigned int slotShift = TIMER_SLOT_BITS * level;
+            if((wheel->now & ((1ULL << slotShift) - 1)) != 0) continue;
+            timerWheel_cascade(wheel, level, (unsigned int)(wheel->now >> slotShift) & (TIMER_SLOTS - 1), due);
+        }
+    }
+    if(target > wheel->now) wheel->now = target;
+}
+
+// Add an event to the wheel, to fall due at its timerDue; returns zero (leaving it to the
+// caller) if that time has already come
+int timerWheel_insert(timerWheel_t *wheel, event_t *event){
+    if(event->timerDue <= wheel->now) return 0;
+    timerWheel_place(wheel, event);
+    wheel->count++;
+    return 1;
+}
+
+// Take every event out of the wheel, chaining them onto all (for deallocation)
+void timerWheel_drain(timerWheel_t *wheel, event_t **all){
+    for(int level = 0; level < TIMER_LEVELS; level++){
+        for(int slot = 0; slot < TIMER_SLOTS; slot++){
+            while(wheel->slots[level][slot] != NULL){
+                event_t *event = wheel->slots[level][slot];
+                wheel->slots[level][slot] = event->next;
+                event->next = *all;
+                *all = event;
+            }
+        }
+        wheel->occupied[level] = 0;
+    }
+    while(wheel->overflow != NULL){
+        event_t *event = wheel->overflow;
+        wheel->overflow = event->next;
+        event->next = *all;
+        *all = event;
+    }
+    wheel->count = 0;
+}
+
+
+
+// A tick budget's usage, packed into one word with the epoch it was last charged in (the epoch
+// in the high half), so starting a new epoch empties every budget at once without touching any
+typedef atomic_ullong budgetWord_t;
+
+#define BUDGET_WORD(epoch, used) (((unsigned long long)(epoch) << 32) | (used))
+
+// Reserve up to n events from a budget of limit per epoch, as many as are left; returns how
+// many were granted, and sets *chargedEpoch to the epoch they were charged in (for refunds)
+unsigned int budget_reserve(budgetWord_t *word, atomic_uint *epochSource, unsigned int limit, unsigned int n, unsigned int *chargedEpoch){
+    unsigned long long current = atomic_load(word);
+    while(1){
+        unsigned int epoch = atomic_load(epochSource);
+        unsigned int wordEpoch = (unsigned int)(current >> 32);
+        unsigned int used = (unsigned int)current;
+        if(wordEpoch != epoch){
+            // A word from an older epoch is empty; one from a newer one means our epoch is stale
+            if((int)(wordEpoch - epoch) > 0){
+                current = atomic_load(word);
+                continue;
+            }
+            used = 0;
+        }
+        unsigned int granted = (used >= limit) ? 0 : limit - used;
+        if(granted > n) granted = n;
+        *chargedEpoch = epoch;
+        if(granted == 0) return 0;
+        if(atomic_compare_exchange_weak(word, &current, BUDGET_WORD(epoch, used + granted))) return granted;
+    }
+}
+
+// Hand back n events reserved in the given epoch (a no-op once the epoch has moved on)
+void budget_refund(budgetWord_t *word, unsigned int epoch, unsigned int n){
+    unsigned long long current = atomic_load(word);
+    while(n > 0 && (unsigned int)(current >> 32) == epoch){
+        unsigned int used = (unsigned int)current;
+        unsigned int returned = (used < n) ? used : n;
+        if(atomic_compare_exchange_weak(word, &current, BUDGET_WORD(epoch, used - returned))) return;
+    }
+}
+
+// Read how much of a budget of limit per epoch is left in the given epoch (lock-free, relaxed)
+unsigned int budget_remaining(budgetWord_t *word, unsigned int epoch, unsigned int limit){
+    unsigned long long current = atomic_load_explicit(word, memory_order_relaxed);
+    unsigned int used = ((unsigned int)(current >> 32) == epoch) ? (unsigned int)current : 0;
+    return (used >= limit) ? 0 : limit - used;
+}
+
+
+// One partition of the event stack, holding the events of the types hashed (or assigned) to it
+// (each on its own cache lines, so events of types in different shards never contend)
+typedef struct eventShard{
+#if EVENT_QUEUE_BACKEND == EVENT_QUEUE_LOCKFREE_RING
+    _Alignas(CACHE_LINE_SIZE) eventRing_t ring;
+#else
+    _Alignas(CACHE_LINE_SIZE) event_t *head;
+    atomic_uint depth;        // Events on the shard (only written under the lock, read without it)
+    pthread_mutex_t lock;
+#endif
+    budgetWord_t budget;      // Events of the shard's types published this epoch, against SHARD_PUBLISHABLE_EVENTS
+} eventShard_t;
+
+// The event stack for live events
+// (in practice only seeded from outside the executors; events published by running
+//  subscribers go to their worker's deque instead)
+typedef struct eventStack{
+    eventShard_t shards[EVENT_SHARDS];   // The stack proper, partitioned by event type
+    eventRing_t lanes[PRIORITY_LEVELS]; // FIFO lanes for ordered (0) and higher priority (1 up) types
+    forwardInbox_t inbox;                // Events forwarded from other buses, for the executors to take in
+    const subscriberSet_t *types;        // Where each event type's shard, priority, ordering and budget are set
+    atomic_uint epoch;                   // The budget epoch: bumped each tick (or burst, when streaming)
+    _Atomic(budgetWord_t *) typeBudgets[EVENT_TYPE_CHUNKS]; // Per-type budget usage, chunked as the registry
+
+    atomic_uint pending;      // Events published but not yet fully processed (queued or in flight)
+    atomic_uint sleepers;     // Executors parked waiting for more events
+    atomic_int streaming;     // Nonzero while served by a streaming pool (see executorPool_startStreaming)
+    atomic_int draining;      // Nonzero once a streaming pool should stop, as soon as nothing is pending
+    pthread_mutex_t parkLock; // Guards parking and waking of executors (and blocked producers)
+    pthread_cond_t parkCond;  // Signalled on publish, broadcast once nothing is pending
+
+    int backpressure;                  // What publish does when an event can't be queued (BACKPRESSURE_*)
+    atomic_uint blockedProducers;      // Producers waiting for room under BACKPRESSURE_BLOCK
+    pthread_cond_t roomCond;           // Broadcast as events finish, while any producers are blocked
+    atomic_ulong dropped;              // Events dropped, ever
+    atomic_ulong droppedReported;      // How many of those have been reported
+    atomic_ullong lastDropReport;      // When they last were (nowNanos)
+
+    event_t *coalesceBuckets[COALESCE_BUCKETS];      // Pending events of coalescing types, by type and key
+    pthread_mutex_t coalesceLocks[COALESCE_STRIPES]; // Bucket b is guarded by lock b % COALESCE_STRIPES
+
+    pthread_mutex_t timerLock;         // Guards both timing wheels
+    timerWheel_t clockTimers;          // Events deferred to a time, in 2^TIMER_RESOLUTION_SHIFT ns units
+    timerWheel_t tickTimers;           // Events deferred to a tick, in ticks
+    atomic_ullong nextTimerDue;        // When (nowNanos) the clock wheel next needs looking at (ULLONG_MAX: never)
+} eventStack_t;
+
+// A per-producer sub-budget: the most events the threads it is set on publish to a stack per
+// tick (or burst, when streaming), on top of the stack's own budgets
+typedef struct producerBudget{
+    eventStack_t *eventStack; // The stack it applies to
+    unsigned int limit;       // Events per epoch
+    budgetWord_t used;        // Events published this epoch
+} producerBudget_t;
+
+// The calling thread's producer budget (NULL if it has none)
+_Thread_local producerBudget_t *tProducerBudget = NULL;
+
+// Initialize a producer budget of limit events per epoch on the given stack
+void producerBudget_init(producerBudget_t *budget, eventStack_t *eventStack, unsigned int limit){
+    budget->eventStack = eventStack;
+    budget->limit = limit;
+    atomic_init(&(budget->used), 0);
+}
+
+// Charge the calling thread's publishes to the given producer budget (NULL for none); several
+// threads may share one
+void setProducerBudget(producerBudget_t *budget){
+    tProducerBudget = budget;
+}
+
+// What publishing an event came to
+#define PUBLISH_OK 0       // Queued
+#define PUBLISH_DROPPED 1  // Dropped by the bus (its data released)
+#define PUBLISH_REJECTED 2 // Refused under BACKPRESSURE_ERROR (its data still the caller's)
+
+#if EVENT_QUEUE_BACKEND == EVENT_QUEUE_LOCKFREE_RING
+// Initialize an event shard
+void eventShard_init(eventShard_t *shard){
+    eventRing_init(&(shard->ring), EVENT_RING_CAPACITY);
+    atomic_init(&(shard->budget), 0);
+}
+
+// Deallocate an event shard
+void eventShard_destroy(eventShard_t *shard){
+    eventRing_destroy(&(shard->ring));
+}
+
+// Check whether an event shard currently holds no events
+int eventShard_isEmpty(eventShard_t *shard){
+    return eventRing_isEmpty(&(shard->ring));
+}
+
+// Add an event to an event shard (ring backend: no lock taken); returns zero if the ring is full
+int eventShard_push(eventShard_t *shard, event_t *event){
+    return eventRing_push(&(shard->ring), event);
+}
+
+// Add a chain of events (linked through next, ending at last) to an event shard, one slot at
+// a time; returns the first event that didn't fit when the ring fills up (NULL if all did)
+event_t *eventShard_pushChain(eventShard_t *shard, event_t *first, event_t *last){
+    event_t *event = first;
+    while(event != NULL){
+        // (read the link first: once pushed, the event may be taken and freed at any time)
+        event_t *next = (event == last) ? NULL : event->next;
+        if(!eventRing_push(&(shard->ring), event)) return event;
+        event = next;
+    }
+    return NULL;
+}
+
+// Remove and return the next event from an event shard (ring backend: no lock taken)
+event_t *eventShard_pop(eventShard_t *shard){
+    return eventRing_pop(&(shard->ring));
+}
+
+// Remove up to max events from an event shard, returned as a NULL-terminated chain
+// (ring backend: each is still claimed separately, but without any lock)
+event_t *eventShard_popMany(eventShard_t *shard, unsigned int max){
+    event_t *first = NULL;
+    event_t *last = NULL;
+    for(unsigned int i = 0; i < max; i++){
+        event_t *event = eventRing_pop(&(shard->ring));
+        if(event == NULL) break;
+        event->next = NULL;
+        if(last == NULL){
+            first = event;
+        } else {
+            last->next = event;
+        }
+        last = event;
+    }
+    return first;
+}
+
+// Estimate how many events an event shard holds (without synchronizing)
+unsigned int eventShard_depth(eventShard_t *shard){
+    return eventRing_depth(&(shard->ring));
+}
+
+// Estimate whether an event shard's ring is full (without synchronizing)
+int eventShard_isFull(eventShard_t *shard){
+    return eventRing_depth(&(shard->ring)) > shard->ring.mask;
+}
+
+// Remove and return the oldest event from an event shard: the ring is FIFO, so the next one
+event_t *eventShard_evictOldest(eventShard_t *shard){
+    return eventRing_pop(&(shard->ring));
+}
+#else
+// Initialize an event shard
+void eventShard_init(eventShard_t *shard){
+    shard->head = NULL;
+    atomic_init(&(shard->depth), 0);
+    pthread_mutex_init(&(shard->lock), NULL);
+    atomic_init(&(shard->budget), 0);
+}
+
+// Deallocate an event shard
+void eventShard_destroy(eventShard_t *shard){
+    pthread_mutex_destroy(&(shard->lock));
+}
+
+// Check whether an event shard currently holds no events
+int eventShard_isEmpty(eventShard_t *shard){
+    acquireLock(&(shard->lock));
+    int empty = (shard->head == NULL);
+    releaseLock(&(shard->lock));
+    return empty;
+}
+
+// Prepend an event to an event shard (never full)
+int eventShard_push(eventShard_t *shard, event_t *event){
+    // Acquire the shard lock
+    acquireLock(&(shard->lock));
+    event->next = shard->head;
+    shard->head = event;
+    atomic_store_explicit(&(shard->depth), atomic_load_explicit(&(shard->depth), memory_order_relaxed) + 1, memory_order_relaxed);
+    // Relinquish the shard lock
+    releaseLock(&(shard->lock));
+    return 1;
+}
+
+// Prepend a chain of events (linked through next, ending at last) to an event shard in one
+// critical section; returns NULL, as all of them always fit
+event_t *eventShard_pushChain(eventShard_t *shard, event_t *first, event_t *last){
+    unsigned int chainLength = 1;
+    for(event_t *event = first; event != last; event = event->next){
+        chainLength++;
+    }
+    // Acquire the shard lock
+    acquireLock(&(shard->lock));
+    last->next = shard->head;
+    shard->head = first;
+    atomic_store_explicit(&(shard->depth), atomic_load_explicit(&(shard->depth), memory_order_relaxed) + chainLength, memory_order_relaxed);
+    // Relinquish the shard lock
+    releaseLock(&(shard->lock));
+    return NULL;
+}
+
+// Remove and return the first event from an event shard
+event_t *eventShard_pop(eventShard_t *shard){
+    // Acquire the shard lock
+    acquireLock(&(shard->lock));
+    // Pop the head event if one exists
+    event_t *doomedEvent = shard->head;
+    if(doomedEvent != NULL){
+        shard->head = doomedEvent->next;
+        atomic_store_explicit(&(shard->depth), atomic_load_explicit(&(shard->depth), memory_order_relaxed) - 1, memory_order_relaxed);
+    }
+    // Relinquish the shard lock
+    releaseLock(&(shard->lock));
+    return doomedEvent;
+}
+
+// Detach up to max events from the top of an event shard in one critical section,
+// returned as a NULL-terminated chain
+event_t *eventShard_popMany(eventShard_t *shard, unsigned int max){
+    // Acquire the shard lock
+    acquireLock(&(shard->lock));
+    event_t *first = shard->head;
+    if(first != NULL){
+        // Walk to the last event to be taken, and cut the chain after it
+        event_t *last = first;
+        unsigned int taken = 1;
+        while(taken < max && last->next != NULL){
+            last = last->next;
+            taken++;
+        }
+        shard->head = last->next;
+        last->next = NULL;
+        atomic_store_explicit(&(shard->depth), atomic_load_explicit(&(shard->depth), memory_order_relaxed) - taken, memory_order_relaxed);
+    }
+    // Relinquish the shard lock
+    releaseLock(&(shard->lock));
+    return first;
+}
+
+// Read how many events an event shard holds (without taking the lock, so perhaps stale)
+unsigned int eventShard_depth(eventShard_t *shard){
+    return atomic_load_explicit(&(shard->depth), memory_order_relaxed);
+}
+
+// Check whether an event shard is full (never: the stack is unbounded)
+int eventShard_isFull(eventShard_t *shard){
+    return 0;
+}
+
+// Remove and return the oldest event from an event shard: the stack is LIFO, so the bottom one
+// (found by walking the whole stack, which is only ever done under overload)
+event_t *eventShard_evictOldest(eventShard_t *shard){
+    // Acquire the shard lock
+    acquireLock(&(shard->lock));
+    event_t **link = &(shard->head);
+    event_t *doomedEvent = NULL;
+    if(*link != NULL){
+        while((*link)->next != NULL){
+            link = &((*link)->next);
+        }
+        doomedEvent = *link;
+        *link = NULL;
+        atomic_store_explicit(&(shard->depth), atomic_load_explicit(&(shard->depth), memory_order_relaxed) - 1, memory_order_relaxed);
+    }
+    // Relinquish the shard lock
+    releaseLock(&(shard->lock));
+    return doomedEvent;
+}
+#endif
+
+// Initialize an event stack, for events of the types registered in the given set
+void eventStack_init(eventStack_t *eventStack, const subscriberSet_t *types){
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        eventShard_init(&(eventStack->shards[i]));
+    }
+    for(int i = 0; i < PRIORITY_LEVELS; i++){
+        eventRing_init(&(eventStack->lanes[i]), LANE_RING_CAPACITY);
+    }
+    forwardInbox_init(&(eventStack->inbox), FORWARD_INBOX_CAPACITY);
+    eventStack->types = types;
+    atomic_init(&(eventStack->epoch), 0);
+    for(int i = 0; i < EVENT_TYPE_CHUNKS; i++){
+        atomic_init(&(eventStack->typeBudgets[i]), NULL);
+    }
+    atomic_init(&(eventStack->pending), 0);
+    atomic_init(&(eventStack->sleepers), 0);
+    atomic_init(&(eventStack->streaming), 0);
+    atomic_init(&(eventStack->draining), 0);
+    pthread_mutex_init(&(eventStack->parkLock), NULL);
+    // (parked streaming executors wait on this until the next timer, by the monotonic clock)
+    pthread_condattr_t parkCondAttr;
+    pthread_condattr_init(&parkCondAttr);
+    pthread_condattr_setclock(&parkCondAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&(eventStack->parkCond), &parkCondAttr);
+    pthread_condattr_destroy(&parkCondAttr);
+    eventStack->backpressure = EVENT_BACKPRESSURE;
+    atomic_init(&(eventStack->blockedProducers), 0);
+    pthread_cond_init(&(eventStack->roomCond), NULL);
+    atomic_init(&(eventStack->dropped), 0);
+    atomic_init(&(eventStack->droppedReported), 0);
+    atomic_init(&(eventStack->lastDropReport), 0);
+    for(int i = 0; i < COALESCE_BUCKETS; i++){
+        eventStack->coalesceBuckets[i] = NULL;
+    }
+    for(int i = 0; i < COALESCE_STRIPES; i++){
+        pthread_mutex_init(&(eventStack->coalesceLocks[i]), NULL);
+    }
+    pthread_mutex_init(&(eventStack->timerLock), NULL);
+    timerWheel_init(&(eventStack->clockTimers), nowNanos() >> TIMER_RESOLUTION_SHIFT);
+    timerWheel_init(&(eventStack->tickTimers), 0);
+    atomic_init(&(eventStack->nextTimerDue), ULLONG_MAX);
+}
+
+// Set what publishing does with events that can't be queued (one of BACKPRESSURE_*;
+// only safe while no one is publishing)
+void eventStack_setBackpressure(eventStack_t *eventStack, int backpressure){
+    eventStack->backpressure = backpressure;
+}
+
+// Deallocate an event stack (once it is empty, and no executor serves it any more; events
+// still deferred are released unpublished)
+void eventStack_destroy(eventStack_t *eventStack){
+    event_t *deferred = NULL;
+    timerWheel_drain(&(eventStack->clockTimers), &deferred);
+    timerWheel_drain(&(eventStack->tickTimers), &deferred);
+    while(deferred != NULL){
+        event_t *next = deferred->next;
+        releaseEventData(eventStack->types, deferred);
+        freeEvent(deferred);
+        deferred = next;
+    }
+    pthread_mutex_destroy(&(eventStack->timerLock));
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        eventShard_destroy(&(eventStack->shards[i]));
+    }
+    for(int i = 0; i < PRIORITY_LEVELS; i++){
+        eventRing_destroy(&(eventStack->lanes[i]));
+    }
+    forwardInbox_destroy(&(eventStack->inbox));
+    for(int i = 0; i < EVENT_TYPE_CHUNKS; i++){
+        free(atomic_load(&(eventStack->typeBudgets[i])));
+    }
+    for(int i = 0; i < COALESCE_STRIPES; i++){
+        pthread_mutex_destroy(&(eventStack->coalesceLocks[i]));
+    }
+    pthread_cond_destroy(&(eventStack->roomCond));
+    pthread_cond_destroy(&(eventStack->parkCond));
+    pthread_mutex_destroy(&(eventStack->parkLock));
+}
+
+// Find which shard holds an event type's events (and budget)
+eventShard_t *eventShardOf(eventStack_t *eventStack, unsigned int eventType){
+    if(EVENT_SHARDS == 1 || eventType >= eventStack->types->typeCount) return &(eventStack->shards[0]);
+    return &(eventStack->shards[getEventType(eventStack->types, eventType)->shard]);
+}
+
+// Start a new budget epoch, emptying every shard, type and producer budget at once
+void eventStack_nextEpoch(eventStack_t *eventStack){
+    atomic_fetch_add(&(eventStack->epoch), 1);
+}
+
+// Read an event stack's budget epoch (lock-free)
+unsigned int eventStack_epoch(eventStack_t *eventStack){
+    return atomic_load(&(eventStack->epoch));
+}
+
+// Find an event type's budget usage on an event stack, allocating its chunk on first use;
+// NULL if the type has no budget of its own
+budgetWord_t *typeBudgetWord(eventStack_t *eventStack, unsigned int eventType){
+    if(eventType >= eventStack->types->typeCount || getEventType(eventStack->types, eventType)->budget == 0) return NULL;
+    _Atomic(budgetWord_t *) *chunkSlot = &(eventStack->typeBudgets[eventType / EVENT_TYPE_CHUNK]);
+    budgetWord_t *chunk = atomic_load(chunkSlot);
+    if(chunk == NULL){
+        // Race to install a fresh (all empty) chunk; losers use the winner's
+        budgetWord_t *newChunk = (budgetWord_t *)calloc(EVENT_TYPE_CHUNK, sizeof(budgetWord_t)); // Perhaps add error checking
+        if(atomic_compare_exchange_strong(chunkSlot, &chunk, newChunk)){
+            chunk = newChunk;
+        } else {
+            free(newChunk);
+        }
+    }
+    return &(chunk[eventType % EVENT_TYPE_CHUNK]);
+}
+
+// Read how many more events of a type may be published this epoch, within its shard's budget
+// and its own (lock-free, so only a snapshot)
+unsigned int eventStack_budgetRemaining(eventStack_t *eventStack, unsigned int eventType){
+    unsigned int epoch = eventStack_epoch(eventStack);
+    unsigned int remaining = budget_remaining(&(eventShardOf(eventStack, eventType)->budget), epoch, SHARD_PUBLISHABLE_EVENTS);
+    budgetWord_t *typeWord = typeBudgetWord(eventStack, eventType);
+    if(typeWord != NULL){
+        unsigned int typeRemaining = budget_remaining(typeWord, epoch, getEventType(eventStack->types, eventType)->budget);
+        if(typeRemaining < remaining) remaining = typeRemaining;
+    }
+    return remaining;
+}
+
+// Add an event to its type's shard of an event stack; returns zero if the shard is full
+int pushEvent(eventStack_t *eventStack, event_t *event){
+    return eventShard_push(eventShardOf(eventStack, event->type), event);
+}
+
+// Remove and return an event from an event stack, trying each shard in turn
+event_t *popEvent(eventStack_t *eventStack){
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        event_t *event = eventShard_pop(&(eventStack->shards[i]));
+        if(event != NULL){
+            STATS_ADD(stackPops, 1);
+            return event;
+        }
+    }
+    return NULL;
+}
+
+// Count a chain of events taken off the event stack
+void countStackPops(const event_t *first){
+#if PUBSUB_STATS
+    unsigned long taken = 0;
+    for(const event_t *event = first; event != NULL; event = event->next){
+        taken++;
+    }
+    if(taken > 0) STATS_ADD(stackPops, taken);
+#endif
+}
+
+// Remove up to max events from the first non-empty shard of an event stack, returned as a
+// NULL-terminated chain
+event_t *popEvents(eventStack_t *eventStack, unsigned int max){
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        event_t *first = eventShard_popMany(&(eventStack->shards[i]), max);
+        if(first != NULL){
+            countStackPops(first);
+            return first;
+        }
+    }
+    return NULL;
+}
+
+// Find which FIFO lane an event type's events go on; -1 for unordered normal priority events,
+// which go on the stack or a deque
+int eventLane(const eventStack_t *eventStack, unsigned int eventType){
+    if(eventType >= eventStack->types->typeCount) return -1;
+    const eventTypeInfo_t *info = getEventType(eventStack->types, eventType);
+    if(info->priority > 0) return (int)info->priority;
+    return info->ordered ? 0 : -1;
+}
+
+// Check whether an event stack has nothing queued, on any shard or any lane
+int eventStack_isIdle(eventStack_t *eventStack){
+    for(int i = 0; i < PRIORITY_LEVELS; i++){
+        if(!eventRing_isEmpty(&(eventStack->lanes[i]))) return 0;
+    }
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        if(!eventShard_isEmpty(&(eventStack->shards[i]))) return 0;
+    }
+    return forwardInbox_isEmpty(&(eventStack->inbox));
+}
+
+// Wake one parked executor, if there are any, to take a newly published event
+void wakeExecutor(eventStack_t *eventStack){
+    if(atomic_load(&(eventStack->sleepers)) > 0){
+        acquireLock(&(eventStack->parkLock));
+        if(pthread_cond_signal(&(eventStack->parkCond))){
+            perror("Signalling failed");
+            exit(2);
+        }
+        releaseLock(&(eventStack->parkLock));
+    }
+}
+
+// Wake every parked executor, e.g. for a whole batch of new events
+void wakeAllExecutors(eventStack_t *eventStack){
+    acquireLock(&(eventStack->parkLock));
+    if(pthread_cond_broadcast(&(eventStack->parkCond))){
+        perror("Signalling failed");
+        exit(2);
+    }
+    releaseLock(&(eventStack->parkLock));
+}
+
+// Check whether the executors serving an event stack are done with it: in tick mode once nothing
+// is pending, when streaming only once the stream is also being drained
+int eventStack_isFinished(eventStack_t *eventStack){
+    if(atomic_load(&(eventStack->pending)) > 0) return 0;
+    return !atomic_load(&(eventStack->streaming)) || atomic_load(&(eventStack->draining));
+}
+
+// Mark a popped event as fully processed; the last one out wakes all parked executors
+// (when streaming, this is also where a burst of events ends, so the tick budget starts over)
+void finishEvent(eventStack_t *eventStack){
+    if(atomic_fetch_sub(&(eventStack->pending), 1) == 1){
+        if(atomic_load(&(eventStack->streaming))) eventStack_nextEpoch(eventStack);
+        wakeAllExecutors(eventStack);
+    }
+
+    // Blocked producers may have room now (see awaitRoom)
+    if(atomic_load(&(eventStack->blockedProducers)) > 0){
+        acquireLock(&(eventStack->parkLock));
+        if(pthread_cond_broadcast(&(eventStack->roomCond))){
+            perror("Signalling failed");
+            exit(2);
+        }
+        releaseLock(&(eventStack->parkLock));
+    }
+}
+
+// Report how many events have been dropped since the last report; unless forced, at most
+// once every DROP_REPORT_INTERVAL_NS (never called with a lock held)
+void reportDroppedEvents(eventStack_t *eventStack, int force){
+    unsigned long dropped = atomic_load(&(eventStack->dropped));
+    if(dropped == atomic_load(&(eventStack->droppedReported))) return;
+
+    // Only the thread that moves the report time on gets to report
+    unsigned long long now = nowNanos();
+    unsigned long long last = atomic_load(&(eventStack->lastDropReport));
+    if(!force && now - last < DROP_REPORT_INTERVAL_NS) return;
+    if(!atomic_compare_exchange_strong(&(eventStack->lastDropReport), &last, now)) return;
+
+    unsigned long reported = atomic_exchange(&(eventStack->droppedReported), dropped);
+    if(dropped > reported){
+        // TODO: Standardize error reporting over all exposed TPECS functionality
+        fprintf(stderr, "%lu event(s) could not be published (tick publishing limit reached or queue full)\n", dropped - reported);
+    }
+}
+
+// Find the coalescing bucket for an event type and key
+unsigned int coalesceBucket(unsigned int eventType, unsigned long long key){
+    unsigned long long hash = (key ^ ((unsigned long long)eventType << 32)) * 0x9E3779B97F4A7C15ULL;
+    return (unsigned int)(hash >> 40) & (COALESCE_BUCKETS - 1);
+}
+
+// Fold a new event into one of its type (and key, for COALESCE_KEY types) already pending, if
+// there is one: the type's reducer merges the new data into the pending event's, then the new
+// event is released and freed, and nonzero returned. Otherwise the new event becomes the
+// pending one (until it starts dispatch, or is dropped) and zero is returned.
+int coalesceEvent(eventStack_t *eventStack, event_t *newEvent, unsigned long long key){
+    const subscriberSet_t *types = eventStack->types;
+    if(newEvent->type >= types->typeCount) return 0;
+    const eventTypeInfo_t *info = getEventType(types, newEvent->type);
+    if(info->coalesce == COALESCE_NONE) return 0;
+    newEvent->coalesceKey = (info->coalesce == COALESCE_KEY) ? key : 0;
+
+    unsigned int bucket = coalesceBucket(newEvent->type, newEvent->coalesceKey);
+    pthread_mutex_t *lock = &(eventStack->coalesceLocks[bucket % COALESCE_STRIPES]);
+    acquireLock(lock);
+    event_t *pendingEvent = eventStack->coalesceBuckets[bucket];
+    while(pendingEvent != NULL && (pendingEvent->type != newEvent->type || pendingEvent->coalesceKey != newEvent->coalesceKey)){
+        pendingEvent = pendingEvent->coalesceNext;
+    }
+    if(pendingEvent == NULL){
+        newEvent->flags |= EVENT_COALESCING;
+        newEvent->coalesceNext = eventStack->coalesceBuckets[bucket];
+        eventStack->coalesceBuckets[bucket] = newEvent;
+        releaseLock(lock);
+        return 0;
+    }
+    // (merged under the lock, so never once the pending event's dispatch has begun)
+    if(info->reducer != NULL) info->reducer(pendingEvent->data, newEvent->data);
+    releaseLock(lock);
+
+    releaseEventData(types, newEvent);
+    freeEvent(newEvent);
+    STATS_ADD(coalesced, 1);
+    return 1;
+}
+
+// Stop later events of the same type (and key) folding into a pending one, as it is about to
+// be dispatched or dropped
+void uncoalesceEvent(eventStack_t *eventStack, event_t *event){
+    if(!(event->flags & EVENT_COALESCING)) return;
+    unsigned int bucket = coalesceBucket(event->type, event->coalesceKey);
+    pthread_mutex_t *lock = &(eventStack->coalesceLocks[bucket % COALESCE_STRIPES]);
+    acquireLock(lock);
+    event_t **link = &(eventStack->coalesceBuckets[bucket]);
+    while(*link != event){
+        link = &((*link)->coalesceNext);
+    }
+    *link = event->coalesceNext;
+    event->flags &= ~EVENT_COALESCING;
+    releaseLock(lock);
+}
+
+// Drop an initialized event that could not be queued: its data is released, and it is counted
+void dropEvent(eventStack_t *eventStack, event_t *event){
+    uncoalesceEvent(eventStack, event);
+    releaseEventData(eventStack->types, event);
+    freeEvent(event);
+    atomic_fetch_add_explicit(&(eventStack->dropped), 1, memory_order_relaxed);
+    reportDroppedEvents(eventStack, 0);
+}
+
+// Find the calling thread's producer budget for an event stack (NULL if it has none there)
+producerBudget_t *producerBudgetFor(eventStack_t *eventStack){
+    producerBudget_t *producer = tProducerBudget;
+    return (producer != NULL && producer->eventStack == eventStack) ? producer : NULL;
+}
+
+// Charge one event against the calling producer's, its type's and its shard's tick budgets;
+// returns zero (charging none of them) if any is spent
+int chargeBudget(eventStack_t *eventStack, unsigned int eventType){
+    unsigned int producerEpoch;
+    unsigned int typeEpoch;
+    unsigned int shardEpoch;
+
+    producerBudget_t *producer = producerBudgetFor(eventStack);
+    if(producer != NULL && !budget_reserve(&(producer->used), &(eventStack->epoch), producer->limit, 1, &producerEpoch)) return 0;
+
+    budgetWord_t *typeWord = typeBudgetWord(eventStack, eventType);
+    if(typeWord != NULL && !budget_reserve(typeWord, &(eventStack->epoch), getEventType(eventStack->types, eventType)->budget, 1, &typeEpoch)){
+        if(producer != NULL) budget_refund(&(producer->used), producerEpoch, 1);
+        return 0;
+    }
+
+    // Ensure that no more than the maximum Events are published
+    if(!budget_reserve(&(eventShardOf(eventStack, eventType)->budget), &(eventStack->epoch), SHARD_PUBLISHABLE_EVENTS, 1, &shardEpoch)){
+        if(typeWord != NULL) budget_refund(typeWord, typeEpoch, 1);
+        if(producer != NULL) budget_refund(&(producer->used), producerEpoch, 1);
+        return 0;
+    }
+    return 1;
+}
+
+// Charge a batch of events against the tick budgets, one step for the producer's and one per
+// shard (types with budgets of their own are still charged one by one); returns how long a
+// prefix of the batch fits
+size_t chargeBudgetBatch(eventStack_t *eventStack, const event_t *events, size_t batchSize){
+    unsigned int producerEpoch;
+    unsigned int shardEpochs[EVENT_SHARDS];
+    unsigned int wanted[EVENT_SHARDS];
+    unsigned int admitted[EVENT_SHARDS];
+    if(batchSize > UINT_MAX) batchSize = UINT_MAX;
+
+    // The producer's budget caps the whole batch
+    producerBudget_t *producer = producerBudgetFor(eventStack);
+    if(producer != NULL) batchSize = budget_reserve(&(producer->used), &(eventStack->epoch), producer->limit, (unsigned int)batchSize, &producerEpoch);
+    size_t producerGranted = batchSize;
+
+    // Tally what the batch wants from each shard, and reserve as much of it as is left
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        wanted[i] = 0;
+    }
+    for(size_t i = 0; i < batchSize; i++){
+        wanted[eventShardOf(eventStack, events[i].type) - eventStack->shards]++;
+    }
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        admitted[i] = (wanted[i] > 0) ? budget_reserve(&(eventStack->shards[i].budget), &(eventStack->epoch), SHARD_PUBLISHABLE_EVENTS, wanted[i], &(shardEpochs[i])) : 0;
+    }
+
+    // Publish up to the first event whose shard (or type) is out of budget
+    size_t prefix = 0;
+    while(prefix < batchSize){
+        unsigned int eventType = events[prefix].type;
+        unsigned int shardIndex = eventShardOf(eventStack, eventType) - eventStack->shards;
+        if(admitted[shardIndex] == 0) break;
+        budgetWord_t *typeWord = typeBudgetWord(eventStack, eventType);
+        unsigned int typeEpoch;
+        if(typeWord != NULL && !budget_reserve(typeWord, &(eventStack->epoch), getEventType(eventStack->types, eventType)->budget, 1, &typeEpoch)) break;
+        admitted[shardIndex]--;
+        prefix++;
+    }
+
+    // Hand back budget reserved beyond the prefix
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        if(admitted[i] > 0) budget_refund(&(eventStack->shards[i].budget), shardEpochs[i], admitted[i]);
+    }
+    if(producer != NULL && producerGranted > prefix) budget_refund(&(producer->used), producerEpoch, (unsigned int)(producerGranted - prefix));
+    return prefix;
+}
+
+// Queue an initialized event: onto its type's lane if it has one, else onto the publishing
+// executor's own deque when published by a subscriber running on one of this stack's
+// executors (worker, NULL for none), otherwise onto its type's shard of the event stack.
+// Returns zero, leaving the event to the caller, if its lane or shard is full.
+int submitEvent(eventStack_t *eventStack, executorWorker_t *worker, event_t *newEvent){
+    // Count the event as pending before any executor can see (and finish) it
+    atomic_fetch_add(&(eventStack->pending), 1);
+
+    int lane = eventLane(eventStack, newEvent->type);
+    if(lane >= 0){
+        if(!eventRing_push(&(eventStack->lanes[lane]), newEvent)){
+            finishEvent(eventStack);
+            return 0;
+        }
+    } else if(worker != NULL && worker->eventStack == eventStack && workerDeque_push(&(worker->deque), newEvent)){
+        // Order the deque push before the sleeper check in wakeExecutor (see parkExecutor)
+        atomic_thread_fence(memory_order_seq_cst);
+    } else if(!pushEvent(eventStack, newEvent)){
+        finishEvent(eventStack);
+        return 0;
+    }
+
+    wakeExecutor(eventStack);
+    return 1;
+}
+
+// Check whether an event of the given type could be queued right now (budget and capacity)
+int eventStack_hasRoom(eventStack_t *eventStack, unsigned int eventType){
+    eventShard_t *shard = eventShardOf(eventStack, eventType);
+    if(eventStack_budgetRemaining(eventStack, eventType) == 0) return 0;
+    int lane = eventLane(eventStack, eventType);
+    if(lane >= 0) return eventRing_depth(&(eventStack->lanes[lane])) <= eventStack->lanes[lane].mask;
+    return !eventShard_isFull(shard);
+}
+
+// Block the calling producer until an event of the given type might fit again; returns zero
+// straight away if nothing is pending, as then nothing would ever make room
+// (N.B. as in parkExecutor, the producer count is raised before the room is rechecked, so
+//  finishEvent either makes room before the check or sees the producer and wakes it)
+int awaitRoom(eventStack_t *eventStack, unsigned int eventType){
+    acquireLock(&(eventStack->parkLock));
+    atomic_fetch_add(&(eventStack->blockedProducers), 1);
+    int waited = 0;
+    if(!eventStack_hasRoom(eventStack, eventType) && atomic_load(&(eventStack->pending)) > 0){
+        if(pthread_cond_wait(&(eventStack->roomCond), &(eventStack->parkLock))){
+            perror("Waiting failed");
+            exit(2);
+        }
+        waited = 1;
+    }
+    int retry = waited || eventStack_hasRoom(eventStack, eventType);
+    atomic_fetch_sub(&(eventStack->blockedProducers), 1);
+    releaseLock(&(eventStack->parkLock));
+    return retry;
+}
+
+// Drop the oldest queued event sharing a new event's lane or shard, to make room for it;
+// returns zero if there was none to drop
+int evictOldestEvent(eventStack_t *eventStack, unsigned int eventType){
+    int lane = eventLane(eventStack, eventType);
+    event_t *doomedEvent = (lane >= 0) ? eventRing_pop(&(eventStack->lanes[lane])) : eventShard_evictOldest(eventShardOf(eventStack, eventType));
+    if(doomedEvent == NULL) return 0;
+    dropEvent(eventStack, doomedEvent);
+    finishEvent(eventStack);
+    return 1;
+}
+
+#if PUBSUB_RECORD
+// One published event in an event log, followed by its length payload bytes
+// (logs are written in the recording machine's byte order, and only replayed there)
+typedef struct recordHeader{
+    unsigned long long publishedAt; // nowNanos() when it was published
+    unsigned long long key;         // The coalescing key it was published under (0 for none)
+    unsigned int epoch;             // The stack's budget epoch it was published in
+    unsigned int type;              // The event's type
+    unsigned int length;            // Payload bytes following the header
+    unsigned int reserved;          // Always 0 (keeps the header free of padding)
+} recordHeader_t;
+
+// A run of one thread's records, filled without locks and written out by the log writer thread
+typedef struct recordBuffer{
+    struct recordBuffer *next;      // Linked List Link (on the writer's queue, or the spares)
+    size_t used;                    // Bytes of records in it so far
+    unsigned char bytes[RECORD_BUFFER_BYTES];
+} recordBuffer_t;
+
+// One thread's part in recording
+typedef struct recordThread{
+    recordBuffer_t *buffer;         // The buffer being filled (NULL until its first record of a recording)
+    struct recordThread *next;      // Linked List Link (all recording threads)
+} recordThread_t;
+
+// The event log recorder: at most one stack is recorded at a time
+typedef struct eventRecorder{
+    _Atomic(const eventStack_t *) stack;      // The stack being recorded (NULL while not recording)
+    FILE *out;                      // Where the log goes
+    pthread_t writer;               // The log writer thread
+    pthread_mutex_t lock;           // Guards all the fields below
+    pthread_cond_t queued;          // Signalled when a buffer is queued, or the recording stops
+    recordBuffer_t *queueHead;      // Full buffers for the writer, oldest first
+    recordBuffer_t *queueTail;
+    recordBuffer_t *spares;         // Written buffers, for reuse
+    recordThread_t *threads;        // Every thread that has recorded
+    int stopping;                   // Nonzero once the writer should exit, when the queue is empty
+    atomic_ulong oversized;         // Events left out of this recording, their data over RECORD_MAX_BYTES
+} eventRecorder_t;
+
+eventRecorder_t gRecorder = { .lock = PTHREAD_MUTEX_INITIALIZER, .queued = PTHREAD_COND_INITIALIZER };
+
+// The calling thread's recording state (NULL until it first records)
+_Thread_local recordThread_t *tRecordThread = NULL;
+
+// The log writer thread: writes out queued buffers in the order they were queued, so the
+// publishing threads never wait on the file
+void *recordWriter(void *unused){
+    acquireLock(&(gRecorder.lock));
+    while(1){
+        while(gRecorder.queueHead == NULL && !gRecorder.stopping){
+            if(pthread_cond_wait(&(gRecorder.queued), &(gRecorder.lock))){
+                perror("Waiting failed");
+                exit(2);
+            }
+        }
+        recordBuffer_t *buffer = gRecorder.queueHead;
+        if(buffer == NULL) break;
+        gRecorder.queueHead = buffer->next;
+        if(gRecorder.queueHead == NULL) gRecorder.queueTail = NULL;
+
+        releaseLock(&(gRecorder.lock));
+        if(fwrite(buffer->bytes, 1, buffer->used, gRecorder.out) != buffer->used) perror("Failed to write event log");
+        acquireLock(&(gRecorder.lock));
+        buffer->next = gRecorder.spares;
+        gRecorder.spares = buffer;
+    }
+    releaseLock(&(gRecorder.lock));
+    return NULL;
+}
+
+// Hand a buffer to the writer thread, with the recorder's lock held
+void record_queue(recordBuffer_t *buffer){
+    buffer->next = NULL;
+    if(gRecorder.queueTail == NULL){
+        gRecorder.queueHead = buffer;
+    } else {
+        gRecorder.queueTail->next = buffer;
+    }
+    gRecorder.queueTail = buffer;
+    if(pthread_cond_signal(&(gRecorder.queued))){
+        perror("Signalling failed");
+        exit(2);
+    }
+}
+
+// Trade the calling thread's buffer (if any) for an empty one: a spare, or a new one
+recordBuffer_t *record_swapBuffer(recordThread_t *thread){
+    acquireLock(&(gRecorder.lock));
+    if(thread->buffer != NULL) record_queue(thread->buffer);
+    recordBuffer_t *buffer = gRecorder.spares;
+    if(buffer != NULL) gRecorder.spares = buffer->next;
+    releaseLock(&(gRecorder.lock));
+
+    if(buffer == NULL) buffer = (recordBuffer_t *)malloc(sizeof(recordBuffer_t)); // Perhaps add error checking
+    buffer->used = 0;
+    thread->buffer = buffer;
+    return buffer;
+}
+
+// Start recording everything published to a stack from outside its subscribers (what they
+// publish in turn is left out, as replaying their causes republishes it) to a log file
+// (one stack at a time; returns zero if one is already being recorded)
+int record_start(const eventStack_t *eventStack, FILE *out){
+    acquireLock(&(gRecorder.lock));
+    if(atomic_load(&(gRecorder.stack)) != NULL){
+        releaseLock(&(gRecorder.lock));
+        // TODO: Standardize errors over all TPECS functions
+        fprintf(stderr, "Event log could not be started (already recording)\n");
+        return 0;
+    }
+    unsigned int fileHeader[2] = { RECORD_MAGIC, RECORD_VERSION };
+    fwrite(fileHeader, sizeof(fileHeader), 1, out);
+    gRecorder.out = out;
+    gRecorder.stopping = 0;
+    atomic_store(&(gRecorder.oversized), 0);
+    if(pthread_create(&(gRecorder.writer), NULL, recordWriter, NULL)){
+        perror("Failed to create pthread");
+        exit(2);
+    }
+    atomic_store(&(gRecorder.stack), eventStack);
+    releaseLock(&(gRecorder.lock));
+    return 1;
+}
+
+// Stop recording, writing out every thread's buffered records and flushing the log
+// (only while nothing is publishing to the recorded stack, e.g. between ticks)
+void record_stop(void){
+    acquireLock(&(gRecorder.lock));
+    if(atomic_load(&(gRecorder.stack)) == NULL){
+        releaseLock(&(gRecorder.lock));
+        return;
+    }
+    atomic_store(&(gRecorder.stack), NULL);
+    for(recordThread_t *thread = gRecorder.threads; thread != NULL; thread = thread->next){
+        if(thread->buffer != NULL) record_queue(thread->buffer);
+        thread->buffer = NULL;
+    }
+    gRecorder.stopping = 1;
+    if(pthread_cond_signal(&(gRecorder.queued))){
+        perror("Signalling failed");
+        exit(2);
+    }
+    releaseLock(&(gRecorder.lock));
+
+    if(pthread_join(gRecorder.writer, NULL)){
+        perror("Failed to join pthread");
+        exit(2);
+    }
+    fflush(gRecorder.out);
+
+    unsigned long oversized = atomic_load(&(gRecorder.oversized));
+    if(oversized > 0){
+        // TODO: Standardize errors over all TPECS functions
+        fprintf(stderr, "%lu event(s) left out of the event log (data over %zu bytes)\n", oversized, RECORD_MAX_BYTES);
+    }
+}
+
+// Deallocate every thread's recording state and the spare buffers (only once recording has
+// stopped, and nothing will record again)
+void record_destroy(void){
+    acquireLock(&(gRecorder.lock));
+    while(gRecorder.threads != NULL){
+        recordThread_t *doomedThread = gRecorder.threads;
+        gRecorder.threads = doomedThread->next;
+        free(doomedThread);
+    }
+    while(gRecorder.spares != NULL){
+        recordBuffer_t *doomedBuffer = gRecorder.spares;
+        gRecorder.spares = doomedBuffer->next;
+        free(doomedBuffer);
+    }
+    releaseLock(&(gRecorder.lock));
+}
+
+// Append one published event to the calling thread's buffer (for the stack being recorded).
+// A record holds at most RECORD_MAX_BYTES of data: events with more are left out of the log
+// rather than cut short (which would replay them with the wrong data), and counted; the first
+// of a recording is reported, and record_stop reports how many there were.
+void recordEvent(const eventStack_t *eventStack, unsigned int eventType, unsigned long long key, const void *data, size_t length){
+    if(length > RECORD_MAX_BYTES){
+        if(atomic_fetch_add(&(gRecorder.oversized), 1) == 0){
+            // TODO: Standardize errors over all TPECS functions
+            fprintf(stderr, "Event of type %u left out of the event log (%zu data bytes, over %zu)\n", eventType, length, RECORD_MAX_BYTES);
+        }
+        return;
+    }
+    recordThread_t *thread = tRecordThread;
+    if(thread == NULL){
+        thread = (recordThread_t *)calloc(1, sizeof(recordThread_t)); // Perhaps add error checking
+        acquireLock(&(gRecorder.lock));
+        thread->next = gRecorder.threads;
+        gRecorder.threads = thread;
+        releaseLock(&(gRecorder.lock));
+        tRecordThread = thread;
+    }
+    recordBuffer_t *buffer = thread->buffer;
+    if(buffer == NULL || buffer->used + sizeof(recordHeader_t) + length > RECORD_BUFFER_BYTES) buffer = record_swapBuffer(thread);
+
+    recordHeader_t header;
+    header.publishedAt = nowNanos();
+    header.key = key;
+    header.epoch = atomic_load_explicit(&(eventStack->epoch), memory_order_relaxed);
+    header.type = eventType;
+    header.length = (unsigned int)length;
+    header.reserved = 0;
+    memcpy(&(buffer->bytes[buffer->used]), &header, sizeof(header));
+    if(length > 0) memcpy(&(buffer->bytes[buffer->used + sizeof(header)]), data, length);
+    buffer->used += sizeof(header) + length;
+}
+
+// Whether an event published to a stack from the given executor belongs in the log
+int recordingEvents(const eventStack_t *eventStack, const executorWorker_t *worker){
+    return worker == NULL && atomic_load_explicit(&(gRecorder.stack), memory_order_relaxed) == eventStack;
+}
+
+// Record an event published by pointer: as much of its data as its type's record size says
+// (see setEventRecordBytes; none by default, as the bus can't know how big it is)
+void recordEventData(const eventStack_t *eventStack, unsigned int eventType, unsigned long long key, const void *data){
+    const subscriberSet_t *types = eventStack->types;
+    size_t length = (data != NULL && eventType < types->typeCount) ? getEventType(types, eventType)->recordBytes : 0;
+    recordEvent(eventStack, eventType, key, data, length);
+}
+#endif
+
+// Publish an initialized event from the given executor (NULL if not published by a subscriber),
+// applying the stack's backpressure policy if it is over its shard's budget or its queue is
+// full (charged if its budget has already been taken).
+// On PUBLISH_REJECTED the event is left to the caller, its data untouched.
+int publishEvent(eventStack_t *eventStack, executorWorker_t *worker, event_t *newEvent, int charged){
+    // (an executor may run and free the event as soon as it is submitted, so it isn't read after)
+    unsigned int eventType = newEvent->type;
+    while(1){
+        if(!charged) charged = chargeBudget(eventStack, eventType);
+        if(charged && submitEvent(eventStack, worker, newEvent)){
+            STATS_ADD(published, 1);
+            STATS_ADD_TYPE(typePublished, eventType, 1);
+            return PUBLISH_OK;
+        }
+
+        switch(eventStack->backpressure){
+        case BACKPRESSURE_BLOCK:
+            // (executors never wait, as the room could only be made by themselves)
+            if(worker == NULL && awaitRoom(eventStack, eventType)){
+                // A full queue keeps the budget charged; a spent budget is charged afresh
+                continue;
+            }
+            break;
+        case BACKPRESSURE_DROP_OLDEST:
+            // The dropped event's budget passes to the new one
+            if(evictOldestEvent(eventStack, eventType)){
+                charged = 1;
+                continue;
+            }
+            break;
+        case BACKPRESSURE_ERROR:
+            return PUBLISH_REJECTED;
+        }
+
+        dropEvent(eventStack, newEvent);
+        return PUBLISH_DROPPED;
+    }
+}
+
+// Publish a new event from the given executor, as for publishWithRelease (coalescing under the key)
+int publishEventFrom(eventStack_t *eventStack, executorWorker_t *worker, unsigned int eventType, unsigned long long key, void *eventData, eventRelease_t release){
+    // Allocate and initialize a new event
+    event_t *newEvent = allocEvent();
+    newEvent->next = NULL;
+    newEvent->type = eventType;
+    newEvent->flags = 0;
+    newEvent->data = eventData;
+    newEvent->release = release;
+#if PUBSUB_TRACE
+    traceEventPublished(newEvent);
+#endif
+#if PUBSUB_RECORD
+    if(recordingEvents(eventStack, worker)) recordEventData(eventStack, eventType, key, eventData);
+#endif
+    if(coalesceEvent(eventStack, newEvent, key)) return PUBLISH_OK;
+
+    int result = publishEvent(eventStack, worker, newEvent, 0);
+    if(result == PUBLISH_REJECTED){
+        uncoalesceEvent(eventStack, newEvent);
+        freeEvent(newEvent);
+    }
+    return result;
+}
+
+// Publish a new event whose data is released by the given function once processed
+// (NULL for the event type's default, releaseBorrowed if the bus must leave it alone);
+// returns PUBLISH_OK, PUBLISH_DROPPED (data already released) or PUBLISH_REJECTED
+// (data still the caller's), as the stack's backpressure policy decides
+int publishWithRelease(eventStack_t *eventStack, unsigned int eventType, void *eventData, eventRelease_t release){
+    return publishEventFrom(eventStack, tCurrentWorker, eventType, 0, eventData, release);
+}
+
+// Publish a new event whose data (if not NULL) is released as its type's default dictates
+// (freed, unless set otherwise with setEventRelease); returns as publishWithRelease
+int publish(eventStack_t *eventStack, unsigned int eventType, void *eventData){
+    return publishWithRelease(eventStack, eventType, eventData, NULL);
+}
+
+// Publish a new event with a copy of the given data from the given executor, as for publishInline
+// (coalescing under the key)
+int publishInlineFrom(eventStack_t *eventStack, executorWorker_t *worker, unsigned int eventType, unsigned long long key, const void *src, size_t len){
+    // Allocate and initialize a new event
+    event_t *newEvent = allocEvent();
+    newEvent->next = NULL;
+    newEvent->type = eventType;
+    if(len <= EVENT_INLINE_BYTES){
+        newEvent->flags = EVENT_DATA_INLINE;
+        newEvent->data = newEvent->inlineData.bytes;
+        newEvent->release = releaseBorrowed;
+    } else {
+        // (the copy is ours, so it is freed whatever the type's default)
+        newEvent->flags = 0;
+        newEvent->data = malloc(len); // Perhaps add error checking
+        newEvent->release = free;
+    }
+    memcpy(newEvent->data, src, len);
+#if PUBSUB_TRACE
+    traceEventPublished(newEvent);
+#endif
+#if PUBSUB_RECORD
+    if(recordingEvents(eventStack, worker)) recordEvent(eventStack, eventType, key, src, len);
+#endif
+    if(coalesceEvent(eventStack, newEvent, key)) return PUBLISH_OK;
+
+    int result = publishEvent(eventStack, worker, newEvent, 0);
+    if(result == PUBLISH_REJECTED){
+        uncoalesceEvent(eventStack, newEvent);
+        releaseEventData(eventStack->types, newEvent);
+        freeEvent(newEvent);
+    }
+    return result;
+}
+
+// Publish a new event with a copy of the given data; small payloads are stored inside the
+// event itself, larger ones fall back to a heap copy. Returns as publishWithRelease.
+int publishInline(eventStack_t *eventStack, unsigned int eventType, const void *src, size_t len){
+    return publishInlineFrom(eventStack, tCurrentWorker, eventType, 0, src, len);
+}
+
+// Publish a new event under a coalescing key: for a COALESCE_KEY type, it is folded into any
+// event with the same key already pending (other types ignore the key). Returns as publish;
+// PUBLISH_OK includes being folded in. (N.B. a rejected event's data is handed back with
+// whatever other events have been folded into it meanwhile.)
+int publishKeyed(eventStack_t *eventStack, unsigned int eventType, unsigned long long key, void *eventData){
+    return publishEventFrom(eventStack, tCurrentWorker, eventType, key, eventData, NULL);
+}
+
+// Publish a new event with a copy of the given data under a coalescing key, as for publishKeyed
+int publishInlineKeyed(eventStack_t *eventStack, unsigned int eventType, unsigned long long key, const void *src, size_t len){
+    return publishInlineFrom(eventStack, tCurrentWorker, eventType, key, src, len);
+}
+
+// Publish from a running subscriber through its handle, as for publishWithRelease (but with
+// no thread-local lookups, and onto the subscriber's own stack, whichever bus that is)
+int publisher_publishWithRelease(publisher_t *publisher, unsigned int eventType, void *eventData, eventRelease_t release){
+    return publishEventFrom(publisher->eventStack, publisher->worker, eventType, 0, eventData, release);
+}
+
+// Publish from a running subscriber through its handle, as for publish
+int publisher_publish(publisher_t *publisher, unsigned int eventType, void *eventData){
+    return publishEventFrom(publisher->eventStack, publisher->worker, eventType, 0, eventData, NULL);
+}
+
+// Publish from a running subscriber through its handle, as for publishInline
+int publisher_publishInline(publisher_t *publisher, unsigned int eventType, const void *src, size_t len){
+    return publishInlineFrom(publisher->eventStack, publisher->worker, eventType, 0, src, len);
+}
+
+// Publish from a running subscriber through its handle, as for publishKeyed
+int publisher_publishKeyed(publisher_t *publisher, unsigned int eventType, unsigned long long key, void *eventData){
+    return publishEventFrom(publisher->eventStack, publisher->worker, eventType, key, eventData, NULL);
+}
+
+// Publish from a running subscriber through its handle, as for publishInlineKeyed
+int publisher_publishInlineKeyed(publisher_t *publisher, unsigned int eventType, unsigned long long key, const void *src, size_t len){
+    return publishInlineFrom(publisher->eventStack, publisher->worker, eventType, key, src, len);
+}
+
+// Forward an event with a copy of the given data to a stack through its inbox, for one of its
+// own executors to publish (see eventStack_takeForwarded); falls back to publishInline if the
+// inbox is full. Returns PUBLISH_OK once in the inbox (the stack's backpressure policy then
+// applies as it is taken in, a rejected event being dropped), else as publishInline.
+int eventStack_forward(eventStack_t *eventStack, unsigned int eventType, const void *src, size_t len){
+    // Held pending from now until taken in, so the stack's tick (or stream) can't end first
+    atomic_fetch_add(&(eventStack->pending), 1);
+    if(!forwardInbox_push(&(eventStack->inbox), eventType, src, len)){
+        finishEvent(eventStack);
+        return publishInline(eventStack, eventType, src, len);
+    }
+#if PUBSUB_RECORD
+    if(recordingEvents(eventStack, tCurrentWorker)) recordEvent(eventStack, eventType, 0, src, len);
+#endif
+
+    // Order the push before the sleeper check in wakeExecutor (see parkExecutor)
+    atomic_thread_fence(memory_order_seq_cst);
+    wakeExecutor(eventStack);
+    return PUBLISH_OK;
+}
+
+// Publish up to EXECUTOR_POP_BATCH events forwarded to a stack, from one of its executors, so
+// their nodes come from that executor's own cache; returns how many were taken in
+unsigned int eventStack_takeForwarded(eventStack_t *eventStack, executorWorker_t *worker){
+    unsigned int taken = 0;
+    forwardedEvent_t forwarded;
+    while(taken < EXECUTOR_POP_BATCH && forwardInbox_pop(&(eventStack->inbox), &forwarded)){
+        int result;
+        if(forwarded.data == NULL){
+            result = publishInlineFrom(eventStack, worker, forwarded.type, 0, forwarded.bytes, forwarded.length);
+        } else {
+            result = publishEventFrom(eventStack, worker, forwarded.type, 0, forwarded.data, free);
+        }
+        if(result == PUBLISH_REJECTED){
+            free(forwarded.data);
+            atomic_fetch_add_explicit(&(eventStack->dropped), 1, memory_order_relaxed);
+            reportDroppedEvents(eventStack, 0);
+        }
+
+        // (published first, so the stack never looks finished in between)
+        finishEvent(eventStack);
+        taken++;
+    }
+    return taken;
+}
+
+// Allocate and initialize a new event as a copy of a publishBatch template
+event_t *copyEventTemplate(const event_t *template){
+    event_t *newEvent = allocEvent();
+    newEvent->next = NULL;
+    newEvent->type = template->type;
+    newEvent->flags = template->flags & EVENT_DATA_INLINE;
+    newEvent->release = template->release;
+    if(template->flags & EVENT_DATA_INLINE){
+        newEvent->inlineData = template->inlineData;
+        newEvent->data = newEvent->inlineData.bytes;
+    } else {
+        newEvent->data = template->data;
+    }
+#if PUBSUB_TRACE
+    traceEventPublished(newEvent);
+#endif
+    return newEvent;
+}
+
+// Hand back one event's charge against the producer's, its type's and its shard's tick budgets
+// (if still in the epoch it was charged in), as for an admitted event that is never queued
+void refundBudget(eventStack_t *eventStack, unsigned int eventType){
+    unsigned int epoch = atomic_load(&(eventStack->epoch));
+    producerBudget_t *producer = producerBudgetFor(eventStack);
+    if(producer != NULL) budget_refund(&(producer->used), epoch, 1);
+    budgetWord_t *typeWord = typeBudgetWord(eventStack, eventType);
+    if(typeWord != NULL) budget_refund(typeWord, epoch, 1);
+    budget_refund(&(eventShardOf(eventStack, eventType)->budget), epoch, 1);
+}
+
+// Give back admitted batch events from index from on, which will never be queued (under
+// BACKPRESSURE_ERROR): copied ones in the chain from leftover (counted as published, and NULL
+// if none) are freed, leaving their data alone, and all have their pending count and budget
+// refunded; returns from, the number of templates consumed
+size_t abandonBatch(eventStack_t *eventStack, const event_t *events, size_t from, size_t admitted, event_t *leftover){
+    while(leftover != NULL){
+        event_t *next = leftover->next;
+        STATS_SUB(published, 1);
+        STATS_SUB_TYPE(typePublished, leftover->type, 1);
+        freeEvent(leftover);
+        leftover = next;
+    }
+    for(size_t i = from; i < admitted; i++){
+        refundBudget(eventStack, events[i].type);
+        finishEvent(eventStack);
+    }
+    if(atomic_load(&(eventStack->sleepers)) > 0) wakeAllExecutors(eventStack);
+    return from;
+}
+
+// Splice a chain of admitted events (counted as published) onto an event shard; events that
+// don't fit are retried alone under the policy, except under BACKPRESSURE_ERROR, where they
+// are handed back instead: returns how many were handed back (from the end of the chain)
+size_t spliceBatchChain(eventStack_t *eventStack, executorWorker_t *worker, int shardIndex, event_t *first, event_t *last, event_t **leftoverOut){
+    event_t *leftover = eventShard_pushChain(&(eventStack->shards[shardIndex]), first, last);
+    if(leftover != NULL && eventStack->backpressure == BACKPRESSURE_ERROR){
+        last->next = NULL;
+        size_t count = 0;
+        for(event_t *event = leftover; event != NULL; event = event->next){
+            count++;
+        }
+        *leftoverOut = leftover;
+        return count;
+    }
+    while(leftover != NULL){
+        // Shard full: retry each that didn't fit alone, as for a full lane
+        // (already admitted, so rejecting them now can only mean dropping them)
+        event_t *next = (leftover == last) ? NULL : leftover->next;
+        STATS_SUB(published, 1);
+        STATS_SUB_TYPE(typePublished, leftover->type, 1);
+        finishEvent(eventStack);
+        publishEvent(eventStack, worker, leftover, 1);
+        leftover = next;
+    }
+    return 0;
+}
+
+// Publish n events at once, with one budget charge and one splice per shard of the event
+// stack (events of types with a lane are still pushed onto their lanes one by one).
+// Each event is copied from its template: type, flags, data and release are taken as for
+// publishWithRelease, and EVENT_DATA_INLINE templates have their inlineData copied too.
+// Events beyond the budget, or that don't fit their queue, go through the backpressure policy
+// one at a time. Returns how many templates were consumed, counted from the front: the bus
+// owns those events' data (queued, or dropped and released); the caller keeps the rest's,
+// which only happens once one is rejected under BACKPRESSURE_ERROR. (So that none after a
+// rejected event is queued, under that policy each shard's chain is spliced as soon as the
+// batch moves on to another shard or a lane, rather than once at the end.)
+size_t publishBatch(eventStack_t *eventStack, const event_t *events, size_t n){
+    executorWorker_t *worker = tCurrentWorker;
+#if PUBSUB_RECORD
+    if(recordingEvents(eventStack, worker)){
+        for(size_t i = 0; i < n; i++){
+            if(events[i].flags & EVENT_DATA_INLINE){
+                recordEvent(eventStack, events[i].type, 0, events[i].inlineData.bytes, EVENT_INLINE_BYTES);
+            } else {
+                recordEventData(eventStack, events[i].type, 0, events[i].data);
+            }
+        }
+    }
+#endif
+    size_t admitted = chargeBudgetBatch(eventStack, events, n);
+    int inOrder = (eventStack->backpressure == BACKPRESSURE_ERROR);
+
+    // Count the admitted events as pending before any executor can see (and finish) them
+    if(admitted > 0) atomic_fetch_add(&(eventStack->pending), (unsigned int)admitted);
+
+    // Allocate and initialize a chain of new events for each shard
+    event_t *first[EVENT_SHARDS];
+    event_t *last[EVENT_SHARDS];
+    event_t *leftover = NULL;
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        first[i] = NULL;
+        last[i] = NULL;
+    }
+    int openShard = -1; // The one shard with a chain, when splicing in order
+    for(size_t i = 0; i < admitted; i++){
+        int lane = eventLane(eventStack, events[i].type);
+        int shardIndex = (lane >= 0) ? -1 : (int)(eventShardOf(eventStack, events[i].type) - eventStack->shards);
+        if(inOrder && openShard >= 0 && shardIndex != openShard){
+            size_t rejected = spliceBatchChain(eventStack, worker, openShard, first[openShard], last[openShard], &leftover);
+            first[openShard] = NULL;
+            last[openShard] = NULL;
+            openShard = -1;
+            if(rejected > 0) return abandonBatch(eventStack, events, i - rejected, admitted, leftover);
+        }
+
+        event_t *newEvent = copyEventTemplate(&(events[i]));
+        if(lane >= 0){
+            if(!eventRing_push(&(eventStack->lanes[lane]), newEvent)){
+                if(inOrder){
+                    freeEvent(newEvent);
+                    return abandonBatch(eventStack, events, i, admitted, NULL);
+                }
+                // Lane full: retry it alone, already charged, under the policy
+                finishEvent(eventStack);
+                publishEvent(eventStack, worker, newEvent, 1);
+            } else {
+                STATS_ADD(published, 1);
+                STATS_ADD_TYPE(typePublished, events[i].type, 1);
+            }
+            continue;
+        }
+        // (counted now, as it may be gone as soon as it is spliced; leftovers are uncounted later)
+        STATS_ADD(published, 1);
+        STATS_ADD_TYPE(typePublished, newEvent->type, 1);
+        if(last[shardIndex] == NULL){
+            first[shardIndex] = newEvent;
+        } else {
+            last[shardIndex]->next = newEvent;
+        }
+        last[shardIndex] = newEvent;
+        openShard = shardIndex;
+    }
+
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        if(first[i] == NULL) continue;
+        size_t rejected = spliceBatchChain(eventStack, worker, i, first[i], last[i], &leftover);
+        if(rejected > 0) return abandonBatch(eventStack, events, admitted - rejected, admitted, leftover);
+    }
+    if(admitted > 0 && atomic_load(&(eventStack->sleepers)) > 0) wakeAllExecutors(eventStack);
+
+    // Then the rest, one at a time under the policy
+    for(size_t i = admitted; i < n; i++){
+        event_t *newEvent = copyEventTemplate(&(events[i]));
+        if(publishEvent(eventStack, worker, newEvent, 0) == PUBLISH_REJECTED){
+            freeEvent(newEvent);
+            return i;
+        }
+    }
+    return n;
+}
+
+// A batch of events being gathered for publishBatch, each with its own copy of its data
+// (for feeding a stack from a log or another process)
+typedef struct eventBatch{
+    event_t templates[EVENT_BATCH_SIZE];
+    size_t count;
+} eventBatch_t;
+
+// Publish a batch's events, releasing the data of any the stack rejects, and empty it
+void eventBatch_flush(eventBatch_t *batch, eventStack_t *eventStack){
+    size_t published = publishBatch(eventStack, batch->templates, batch->count);
+    for(size_t i = published; i < batch->count; i++){
+        if(!(batch->templates[i].flags & EVENT_DATA_INLINE)) free(batch->templates[i].data);
+    }
+    batch->count = 0;
+}
+
+// Add an event with a copy of the given data to a batch (inline if it fits), publishing the
+// batch once full. Events of coalescing types are published there and then, after the batch
+// so far, as publishBatch never coalesces.
+void eventBatch_add(eventBatch_t *batch, eventStack_t *eventStack, unsigned int eventType, unsigned long long key, const void *src, size_t len){
+    const subscriberSet_t *types = eventStack->types;
+    if(eventType < types->typeCount && getEventType(types, eventType)->coalesce != COALESCE_NONE){
+        eventBatch_flush(batch, eventStack);
+        publishInlineKeyed(eventStack, eventType, key, src, len);
+        return;
+    }
+
+    event_t *template = &(batch->templates[batch->count++]);
+    template->type = eventType;
+    template->release = NULL;
+    if(len == 0){
+        template->flags = 0;
+        template->data = NULL;
+    } else if(len <= EVENT_INLINE_BYTES){
+        template->flags = EVENT_DATA_INLINE;
+        memcpy(template->inlineData.bytes, src, len);
+    } else {
+        template->flags = 0;
+        template->data = malloc(len); // Perhaps add error checking
+        memcpy(template->data, src, len);
+        template->release = free;
+    }
+    if(batch->count == EVENT_BATCH_SIZE) eventBatch_flush(batch, eventStack);
+}
+
+// Queue a chain of deferred events that have fallen due, each as if just published (charged
+// to the current tick's budgets, coalescing as their type says); any the backpressure policy
+// won't take are dropped, as there is no longer a caller to hand them back to
+void publishDueEvents(eventStack_t *eventStack, event_t *due){
+    while(due != NULL){
+        event_t *newEvent = due;
+        due = due->next;
+        newEvent->next = NULL;
+#if PUBSUB_TRACE
+        traceEventPublished(newEvent);
+#endif
+        if(coalesceEvent(eventStack, newEvent, 0)) continue;
+        if(publishEvent(eventStack, tCurrentWorker, newEvent, 0) == PUBLISH_REJECTED) dropEvent(eventStack, newEvent);
+    }
+}
+
+// Note when the clock wheel next needs looking at (with the timer lock held)
+void eventStack_updateNextTimer(eventStack_t *eventStack){
+    unsigned long long next = timerWheel_nextTime(&(eventStack->clockTimers));
+    atomic_store(&(eventStack->nextTimerDue), (next == ULLONG_MAX) ? ULLONG_MAX : next << TIMER_RESOLUTION_SHIFT);
+}
+
+// Queue every deferred event that has fallen due: those due by the clock, and, if a tick is
+// starting, those due this tick
+void eventStack_fireTimers(eventStack_t *eventStack, int tickStarting){
+    event_t *due = NULL;
+    acquireLock(&(eventStack->timerLock));
+    if(tickStarting) timerWheel_advance(&(eventStack->tickTimers), eventStack->tickTimers.now + 1, &due);
+    timerWheel_advance(&(eventStack->clockTimers), nowNanos() >> TIMER_RESOLUTION_SHIFT, &due);
+    eventStack_updateNextTimer(eventStack);
+    releaseLock(&(eventStack->timerLock));
+    publishDueEvents(eventStack, due);
+}
+
+// Check whether a streaming stack has clock timers due
+int eventStack_timersDue(eventStack_t *eventStack){
+    unsigned long long next = atomic_load_explicit(&(eventStack->nextTimerDue), memory_order_relaxed);
+    return next != ULLONG_MAX && nowNanos() >= next;
+}
+
+// Defer a new event onto one of the stack's wheels, or publish it right away if it is already due
+int deferEvent(eventStack_t *eventStack, int byTicks, unsigned long long due, unsigned int eventType, void *eventData){
+    event_t *newEvent = allocEvent();
+    newEvent->next = NULL;
+    newEvent->type = eventType;
+    newEvent->flags = 0;
+    newEvent->data = eventData;
+    newEvent->release = NULL;
+    newEvent->timerDue = due;
+
+    acquireLock(&(eventStack->timerLock));
+    int deferred = timerWheel_insert(byTicks ? &(eventStack->tickTimers) : &(eventStack->clockTimers), newEvent);
+    if(deferred && !byTicks) eventStack_updateNextTimer(eventStack);
+    releaseLock(&(eventStack->timerLock));
+    if(deferred){
+        // Wake a parked streaming executor, to wait for this one instead
+        if(!byTicks) wakeExecutor(eventStack);
+        return PUBLISH_OK;
+    }
+    publishDueEvents(eventStack, newEvent);
+    return PUBLISH_OK;
+}
+
+// Publish a new event (its data released as for publish) once the monotonic clock reaches the
+// given time, in nowNanos() terms (rounded up to TIMER_RESOLUTION_SHIFT): at the start of the
+// first tick after then, or as soon as it falls due while the stack is streaming.
+// Deferred events are only charged to a budget when they are queued, and are dropped if they
+// can't be (there is no caller left to reject them to); returns PUBLISH_OK.
+int publishAt(eventStack_t *eventStack, unsigned int eventType, void *eventData, unsigned long long deadline){
+    unsigned long long due = (deadline + (1ULL << TIMER_RESOLUTION_SHIFT) - 1) >> TIMER_RESOLUTION_SHIFT;
+    return deferEvent(eventStack, 0, due, eventType, eventData);
+}
+
+// Publish a new event once the given number of nanoseconds have passed, as for publishAt
+int publishAfter(eventStack_t *eventStack, unsigned int eventType, void *eventData, unsigned long long delay){
+    return publishAt(eventStack, eventType, eventData, nowNanos() + delay);
+}
+
+// Publish a new event at the start of the given number of ticks from now (1 for the next;
+// runAllEvents and executorPool_startStreaming each start one), as for publishAt
+int publishAfterTicks(eventStack_t *eventStack, unsigned int eventType, void *eventData, unsigned int ticks){
+    acquireLock(&(eventStack->timerLock));
+    unsigned long long due = eventStack->tickTimers.now + ticks;
+    releaseLock(&(eventStack->timerLock));
+    return deferEvent(eventStack, 1, due, eventType, eventData);
+}
+
+// Take a snapshot of the bus's counters, along with an event stack's drops, depth and epoch
+// (the counters are process-wide, and all zero when built with PUBSUB_STATS=0)
+void pubsub_stats(eventStack_t *eventStack, pubsubStats_t *out){
+#if PUBSUB_STATS
+    statsCollect(out);
+#else
+    memset(out, 0, sizeof(pubsubStats_t));
+#endif
+    out->dropped = atomic_load(&(eventStack->dropped));
+    out->queued = 0;
+    for(int i = 0; i < EVENT_SHARDS; i++){
+        out->queued += eventShard_depth(&(eventStack->shards[i]));
+    }
+    for(int i = 0; i < PRIORITY_LEVELS; i++){
+        out->queued += eventRing_depth(&(eventStack->lanes[i]));
+    }
+    out->pending = atomic_load(&(eventStack->pending));
+    out->epoch = eventStack_epoch(eventStack);
+    acquireLock(&(eventStack->timerLock));
+    out->deferred = eventStack->clockTimers.count + eventStack->tickTimers.count;
+    releaseLock(&(eventStack->timerLock));
+}
+
+
+
+// ========== MULTITHREADED EVENT SUBSCRIBER EXECUTION ==========
+// How an executor pool's workers are run (see executorConfig_init for the defaults)
+typedef struct executorConfig{
+    int threadCount;            // The number of workers, counting the caller if callerIsWorker
+    int node;                   // Pin every worker to this NUMA node's CPUs (-1 for none; see cpus)
+#ifdef __linux__
+    const cpu_set_t *cpus;      // If not NULL, worker i is pinned to cpus[i] instead (threadCount masks)
+#endif
+    int schedPolicy;            // SCHED_OTHER, or a real-time class (SCHED_FIFO, SCHED_RR)
+    int schedPriority;          // The workers' priority within a real-time class
+    int callerIsWorker;         // Nonzero to have the thread calling runAllEvents serve as worker 0
+} executorConfig_t;
+
+// Set an executor configuration to the defaults: THREAD_COUNT unpinned, normally scheduled threads
+void executorConfig_init(executorConfig_t *config){
+    config->threadCount = THREAD_COUNT;
+    config->node = -1;
+#ifdef __linux__
+    config->cpus = NULL;
+#endif
+    config->schedPolicy = SCHED_OTHER;
+    config->schedPriority = 0;
+    config->callerIsWorker = 0;
+}
+
+// A persistent pool of executor threads, which park between ticks
+typedef struct executorPool{
+    eventStack_t *eventStack;   // The stack the workers drain each tick
+    subscriberSet_t *sSet;      // The subscribers the workers invoke
+    int threadCount;            // The number of worker threads
+    pthread_t *threads;         // The worker threads themselves
+    executorWorker_t *workers;  // Their per-thread state
+    pthread_mutex_t lock;       // Guards all the fields below
+    pthread_cond_t tickStart;   // Signalled when a tick begins (or the pool shuts down)
+    pthread_cond_t tickDone;    // Signalled when the last busy worker finishes a tick
+    unsigned long tick;         // Tick counter; bumped to wake the workers
+    int busyWorkers;            // The number of workers still running the current tick (or stream)
+    int shutdown;               // Nonzero once the workers should exit
+    unsigned int spinLimit;     // Empty polls an idle worker makes before parking (see executorPool_setSpinLimit)
+    int node;                   // The NUMA node the workers are pinned to (-1 for none)
+    int callerIsWorker;         // Nonzero if worker 0 is the thread running the ticks, not one of ours
+    tableReader_t reader;       // The pool's standing with the subscriber set's table reclamation
+} executorPool_t;
+
+// Check whether any work is queued for a pool, on its stack or on any worker's deque
+int executorPool_hasWork(executorPool_t *pool){
+    for(int i = 0; i < pool->threadCount; i++){
+        if(!workerDeque_isEmpty(&(pool->workers[i].deque))) return 1;
+    }
+    return !eventStack_isIdle(pool->eventStack);
+}
+
+// Steal an event from another worker's deque, trying each peer in turn from our right
+event_t *stealEvent(executorWorker_t *worker){
+    executorPool_t *pool = worker->pool;
+    for(int i = 1; i < pool->threadCount; i++){
+        executorWorker_t *victim = &(pool->workers[(worker->id + i) % pool->threadCount]);
+        event_t *stolen = workerDeque_steal(&(victim->deque));
+        if(stolen != NULL){
+            STATS_ADD(steals, 1);
+            return stolen;
+        }
+    }
+    return NULL;
+}
+
+// Take a batch of events from the event stack, sized to the calling worker's fair share of
+// what its shard holds; the first is returned for processing, the rest go on the worker's deque
+// (where idle peers can still steal them, so taking a big batch never starves anyone).
+// Each worker is homed on shard id % EVENT_SHARDS, and only moves on to the others when it is empty.
+event_t *takeEvents(executorWorker_t *worker){
+    eventStack_t *eventStack = worker->eventStack;
+    event_t *first = NULL;
+    for(int i = 0; i < EVENT_SHARDS && first == NULL; i++){
+        eventShard_t *shard = &(eventStack->shards[(worker->id + i) % EVENT_SHARDS]);
+        unsigned int max = 1 + eventShard_depth(shard) / worker->pool->threadCount;
+        if(max > EXECUTOR_POP_BATCH) max = EXECUTOR_POP_BATCH;
+        first = eventShard_popMany(shard, max);
+    }
+    countStackPops(first);
+    if(first == NULL || first->next == NULL) return first;
+
+    event_t *event = first->next;
+    while(event != NULL){
+        event_t *next = event->next;
+        if(!workerDeque_push(&(worker->deque), event)) pushEvent(eventStack, event); // (can't fail: it came from there)
+        event = next;
+    }
+    // Wake a peer to help with the rest (ordered as in submitEvent)
+    atomic_thread_fence(memory_order_seq_cst);
+    wakeExecutor(eventStack);
+    return first;
+}
+
+// Park the calling executor until some work is queued again, or its stack is finished with
+// (N.B. the sleeper count is raised before the queues are rechecked, so a concurrent publish
+//  either lands before the check or sees the sleeper and signals it)
+void parkExecutor(executorWorker_t *worker){
+    eventStack_t *eventStack = worker->eventStack;
+    STATS_ADD(parks, 1);
+    acquireLock(&(eventStack->parkLock));
+    atomic_fetch_add(&(eventStack->sleepers), 1);
+    int timerDue = 0;
+    while(!eventStack_isFinished(eventStack) && !executorPool_hasWork(worker->pool) && !timerDue){
+        // When streaming, only wait until the next clock timer falls due (deferEvent wakes us
+        // if an earlier one is set meanwhile)
+        unsigned long long nextTimer = atomic_load(&(eventStack->nextTimerDue));
+        int error;
+        if(nextTimer == ULLONG_MAX || !atomic_load(&(eventStack->streaming))){
+            error = pthread_cond_wait(&(eventStack->parkCond), &(eventStack->parkLock));
+        } else {
+            struct timespec deadline = { (time_t)(nextTimer / 1000000000ULL), (long)(nextTimer % 1000000000ULL) };
+            error = pthread_cond_timedwait(&(eventStack->parkCond), &(eventStack->parkLock), &deadline);
+            if(error == ETIMEDOUT){
+                timerDue = 1;
+                error = 0;
+            }
+        }
+        if(error){
+            perror("Waiting failed");
+            exit(2);
+        }
+    }
+    atomic_fetch_sub(&(eventStack->sleepers), 1);
+    releaseLock(&(eventStack->parkLock));
+
+    if(timerDue) eventStack_fireTimers(eventStack, 0);
+}
+
+#if defined(DEMO_STATIC_SUBSCRIBERS) && !defined(PUBSUB_BENCH) && !defined(PUBSUB_STATIC_TYPES)
+// The demo's subscriptions (see main), compiled in instead
+#define PUBSUB_STATIC_TYPES(TYPE, SUBSCRIBER) \
+    TYPE(0, SUBSCRIBER(testSubOne, NULL)) \
+    TYPE(1, SUBSCRIBER(testSubTwo, NULL)) \
+    TYPE(2, SUBSCRIBER(testSubThree, NULL)) \
+    TYPE(3, SUBSCRIBER(testSubFour, NULL)) \
+    TYPE(4, SUBSCRIBER(testSubFive, NULL)) \
+    TYPE(5, SUBSCRIBER(testSubRecursion, NULL) SUBSCRIBER(testSubRecursion, NULL))
+#endif
+#ifdef PUBSUB_STATIC_TYPES
+#include "pubSubStatic.h"
+#endif
+
+// Run a range of an event type's subscribers (dispatch table entries begin up to end) on an
+// event's data
+void runSubscribers(const dispatchTable_t *table, unsigned int begin, unsigned int end, void *data, publisher_t *publisher){
+    for(unsigned int i = begin; i < end; i++){
+        // Run the subscribed function, handing down its context, the event data and our handle
+        const subscriberEntry_t *entry = &(table->entries[i]);
+#if PUBSUB_TIMING
+        unsigned long long callStart = nowNanos();
+        entry->subscriberFunction(entry->ctx, data, publisher);
+        timingRecord(entry->id, nowNanos() - callStart);
+#else
+        entry->subscriberFunction(entry->ctx, data, publisher);
+#endif
+    }
+    STATS_ADD(subscriberCalls, end - begin);
+}
+
+// Be done with a dispatched event: release its data and deallocate it, and only then let the
+// tick be considered done (if nothing else is pending)
+void retireEvent(eventStack_t *eventStack, const subscriberSet_t *sSet, event_t *event){
+    STATS_ADD(dispatched, 1);
+    STATS_ADD_TYPE(typeDispatched, event->type, 1);
+
+    // Release the event's data, as the event or else its type says
+    releaseEventData(sSet, event);
+    // Deallocate the event
+    freeEvent(event);
+    finishEvent(eventStack);
+}
+
+// Note that one of a fanned-out event's subscriber ranges has run; the last to finish retires it
+// (acquire-release, so its data is only released after every range's subscribers are done with it)
+void fanoutTaskDone(eventStack_t *eventStack, const subscriberSet_t *sSet, event_t *event){
+    if(atomic_fetch_sub_explicit(&(event->fanoutRefs), 1, memory_order_acq_rel) == 1) retireEvent(eventStack, sSet, event);
+}
+
+// Split a fan-out event's subscribers (begin up to end) into ranges of chunk, handing all but the
+// first to the worker's deque as tasks for idle peers to steal; returns the end of the first range,
+// which the caller runs itself before calling fanoutTaskDone
+unsigned int fanoutEvent(executorWorker_t *worker, const dispatchTable_t *table, event_t *event, unsigned int begin, unsigned int end, unsigned int chunk, publisher_t *publisher){
+    unsigned int tasks = (end - begin + chunk - 1) / chunk;
+    atomic_store_explicit(&(event->fanoutRefs), tasks, memory_order_relaxed);
+
+    int queued = 0;
+    for(unsigned int taskBegin = begin + chunk; taskBegin < end; taskBegin += chunk){
+        event_t *task = allocEvent();
+        task->type = event->type;
+        task->flags = EVENT_FANOUT_TASK;
+        task->data = NULL;
+        task->next = NULL;
+        task->fanoutParent = event;
+        task->taskTable = table;
+        task->taskBegin = taskBegin;
+        task->taskEnd = (end - taskBegin > chunk) ? taskBegin + chunk : end;
+        if(workerDeque_push(&(worker->deque), task)){
+            queued = 1;
+        } else {
+            // Deque full: run the range now (the event can't retire, as we still hold its first range)
+            runSubscribers(table, task->taskBegin, task->taskEnd, event->data, publisher);
+            freeEvent(task);
+            atomic_fetch_sub_explicit(&(event->fanoutRefs), 1, memory_order_relaxed);
+        }
+    }
+    if(queued){
+        // Wake peers to help (ordered as in submitEvent)
+        atomic_thread_fence(memory_order_seq_cst);
+        if(atomic_load(&(worker->eventStack->sleepers)) > 0) wakeAllExecutors(worker->eventStack);
+    }
+    return begin + chunk;
+}
+
+// Repeatedly executes all subscribers to events taken from the priority lanes, the worker's
+// own deque, the event stack or (failing all those) a peer's deque
+void eventExecutor(executorWorker_t *worker){
+    eventStack_t *eventStack = worker->eventStack;
+    subscriberSet_t *sSet = worker->pool->sSet;
+    publisher_t publisher = { eventStack, worker };
+
+    // Fetch events until none are queued and none are being processed
+    // (a running subscriber may still publish more, so empty queues alone aren't the end)
+    event_t *currentEvent;
+    unsigned int idleSpins = 0;
+    unsigned int sinceTimerPoll = 0;
+    while(1){
+
+        // Higher priority lanes always come first; at normal priority, prefer our own
+        // (cache-hot) events, then ordered ones, then fresh ones, then a peer's
+        currentEvent = NULL;
+        for(int lane = PRIORITY_LEVELS - 1; lane > 0 && currentEvent == NULL; lane--){
+            currentEvent = eventRing_pop(&(eventStack->lanes[lane]));
+            if(currentEvent != NULL) STATS_ADD(stackPops, 1);
+        }
+        if(currentEvent == NULL){
+            currentEvent = workerDeque_pop(&(worker->deque));
+            if(currentEvent != NULL) STATS_ADD(dequePops, 1);
+        }
+        if(currentEvent == NULL){
+            currentEvent = eventRing_pop(&(eventStack->lanes[0]));
+            if(currentEvent != NULL) STATS_ADD(stackPops, 1);
+        }
+        if(currentEvent == NULL && !forwardInbox_isEmpty(&(eventStack->inbox)) && eventStack_takeForwarded(eventStack, worker) > 0){
+            currentEvent = workerDeque_pop(&(worker->deque));
+            if(currentEvent != NULL) STATS_ADD(dequePops, 1);
+        }
+        if(currentEvent == NULL) currentEvent = takeEvents(worker);
+        if(currentEvent == NULL) currentEvent = stealEvent(worker);
+
+        if(currentEvent == NULL){
+            // Stop once the tick is quiescent (or the stream drained), otherwise poll a while
+            // longer, then wait for more to be published
+            if(eventStack_isFinished(eventStack)) break;
+            if(idleSpins < worker->pool->spinLimit){
+                idleSpins++;
+                cpuRelax();
+                continue;
+            }
+            parkExecutor(worker);
+            idleSpins = 0;
+        } else {
+            idleSpins = 0;
+            // While streaming, timers falling due mustn't wait for the executors to run dry
+            // (nor, either way, should events forwarded from other buses)
+            if(++sinceTimerPoll == TIMER_POLL_EVENTS){
+                sinceTimerPoll = 0;
+                if(!forwardInbox_isEmpty(&(eventStack->inbox))) eventStack_takeForwarded(eventStack, worker);
+                if(atomic_load_explicit(&(eventStack->streaming), memory_order_relaxed) && eventStack_timersDue(eventStack)){
+                    eventStack_fireTimers(eventStack, 0);
+                }
+            }
+            if(currentEvent->flags & EVENT_FANOUT_TASK){
+                // A share of a fanned-out event's subscribers
+                event_t *parent = currentEvent->fanoutParent;
+#if PUBSUB_TRACE
+                tTraceParent = parent->traceId;
+#endif
+                runSubscribers(currentEvent->taskTable, currentEvent->taskBegin, currentEvent->taskEnd, parent->data, &publisher);
+#if PUBSUB_TRACE
+                tTraceParent = 0;
+#endif
+                freeEvent(currentEvent);
+                fanoutTaskDone(eventStack, sSet, parent);
+                continue;
+            }
+
+            // Dispatch from the table current now (tables are never changed once published, and
+            // this one can't be reclaimed before the tick ends)
+            const dispatchTable_t *table = atomic_load_explicit(&(sSet->table), memory_order_acquire);
+            if(currentEvent->type >= table->typeCount){
+                // Event falls outside the range of valid events
+                // TODO: Standardize errors over all TPECS functions
+                fprintf(stderr, "Event of type %u found (not in valid range 0-%d)\n", currentEvent->type, (int)table->typeCount - 1);
+                retireEvent(eventStack, sSet, currentEvent);
+            } else {
+                // From here on, new events of its type (and key) are events of their own
+                if(currentEvent->flags & EVENT_COALESCING) uncoalesceEvent(eventStack, currentEvent);
+#if PUBSUB_TRACE
+                // Anything the subscribers publish is this event's child
+                unsigned long long traceStart = 0;
+                if(currentEvent->traceId != 0){
+                    tTraceParent = currentEvent->traceId;
+                    traceStart = nowNanos();
+                }
+#endif
+#ifdef PUBSUB_STATIC_TYPES
+                // Subscribers compiled in come first, called directly
+                staticSubscribers_dispatch(currentEvent->type, currentEvent->data, &publisher);
+#endif
+                // Invoke all subscribers to this event, sharing them out first if its type fans out
+                // (the trace then shows only this worker's share)
+                unsigned int begin = table->offsets[currentEvent->type];
+                unsigned int end = table->offsets[currentEvent->type + 1];
+                unsigned int chunk = table->fanouts[currentEvent->type];
+                int fannedOut = (chunk > 0 && end - begin > chunk);
+                if(fannedOut) end = fanoutEvent(worker, table, currentEvent, begin, end, chunk, &publisher);
+                runSubscribers(table, begin, end, currentEvent->data, &publisher);
+#if PUBSUB_TRACE
+                if(currentEvent->traceId != 0){
+                    traceEventDispatched(currentEvent, worker->id, traceStart, nowNanos());
+                    tTraceParent = 0;
+                }
+#endif
+                if(fannedOut){
+                    fanoutTaskDone(eventStack, sSet, currentEvent);
+                } else {
+                    retireEvent(eventStack, sSet, currentEvent);
+                }
+            }
+        }
+
+    }
+}
+
+// Thread function for pool workers: parks until a tick begins, runs the tick, parks again
+void *poolWorker(void *p){
+    executorWorker_t *worker = (executorWorker_t *)p;
+    executorPool_t *pool = worker->pool;
+    unsigned long lastTick = 0;
 
-#define EVENT_TYPES 26  // The total number of event types (arbitrary)
+    // Let publish() find this worker's deque, and have its node cache ready before the first tick
+    tCurrentWorker = worker;
+    eventAllocator_prepareThread();
 
+    acquireLock(&(pool->lock));
+    while(1){
+        // Park until the tick counter moves on, or the pool is shut down
+        while(pool->tick == lastTick && !pool->shutdown){
+            if(pthread_cond_wait(&(pool->tickStart), &(pool->lock))){
+                perror("Waiting failed");
+                exit(2);
+            }
+        }
+        if(pool->shutdown) break;
+        lastTick = pool->tick;
 
-// ========== SUBSCRIPTION DEFINITIONS ==========
-// A node in a list of event subscribers
-typedef struct subscriberNode{
-    void (*subscriberFunction)(void *); // The subscriber function
-    struct subscriberNode *next;        // Linked List Link
-} subscriberNode_t;
+        // Run the tick without holding the pool lock
+        releaseLock(&(pool->lock));
+        eventExecutor(worker);
+        acquireLock(&(pool->lock));
 
-// A set of all event subscribers, ordered in a map by event type
-typedef struct subscriberSet{
-    subscriberNode_t * map[EVENT_TYPES]; // Each item of map points to a list of subscribers
-                                         // which respond to that event
-} subscriberSet_t;
+        // The last worker out reports the tick as done
+        if(--pool->busyWorkers == 0){
+            if(pthread_cond_signal(&(pool->tickDone))){
+                perror("Signalling failed");
+                exit(2);
+            }
+        }
+    }
+    releaseLock(&(pool->lock));
 
-// Initialize a subscriber set (simply nulls its buckets)
-void initSubscriberSet(subscriberSet_t *sSet){
-    for(int i = 0; i < EVENT_TYPES; i++){
-        sSet->map[i] = NULL;
+    // Let the next thread have this one's node cache and counters
+    eventAllocator_releaseThread();
+    stats_releaseThread();
+    return NULL;
+}
+
+// Apply a configuration's CPU mask and scheduling for worker i to a thread's attributes
+void executorConfig_applyTo(const executorConfig_t *config, int i, pthread_attr_t *attr){
+#ifdef __linux__
+    cpu_set_t nodeCpus;
+    if(config->cpus != NULL){
+        pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &(config->cpus[i]));
+    } else if(config->node >= 0 && numa_nodeCpus(config->node, &nodeCpus)){
+        pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &nodeCpus);
+    }
+#endif
+    if(config->schedPolicy != SCHED_OTHER){
+        struct sched_param param = { .sched_priority = config->schedPriority };
+        pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(attr, config->schedPolicy);
+        pthread_attr_setschedparam(attr, &param);
     }
 }
 
-// Deallocate a subscriber set
-void destroySubscriberSet(subscriberSet_t *sSet){
-    for(int i = 0; i < EVENT_TYPES; i++){
-        // Linked-List free all nodes in the ith bucket
-        subscriberNode_t *temp;
-        while(sSet->map[i] != NULL){
-            temp = sSet->map[i];
-            sSet->map[i] = temp->next;
-            free(temp);
+// Apply a configuration's CPU mask and scheduling for worker 0 to the calling thread, for good
+void executorConfig_applyToCaller(const executorConfig_t *config){
+#ifdef __linux__
+    cpu_set_t nodeCpus;
+    if(config->cpus != NULL){
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &(config->cpus[0]));
+    } else if(config->node >= 0 && numa_nodeCpus(config->node, &nodeCpus)){
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &nodeCpus);
+    }
+#endif
+    if(config->schedPolicy != SCHED_OTHER){
+        struct sched_param param = { .sched_priority = config->schedPriority };
+        int error = pthread_setschedparam(pthread_self(), config->schedPolicy, &param);
+        if(error){
+            // TODO: Standardize errors over all TPECS functions
+            fprintf(stderr, "Calling worker keeps its scheduling class (%s)\n", strerror(error));
         }
     }
 }
 
-// Add a subscriber to the subscriber set
-void subscribe(subscriberSet_t *sSet, unsigned int eventType, void (*subscriberFunction)(void *)){
-    subscriberNode_t *newSub = (subscriberNode_t *)malloc(sizeof(subscriberNode_t)); // Perhaps add error checking
-    newSub->subscriberFunction = subscriberFunction;
-    newSub->next = sSet->map[eventType];
-    sSet->map[eventType] = newSub;
-}
+// Initialize an executor pool as configured, launching its (initially parked) worker threads.
+// With callerIsWorker, one thread fewer is launched: the thread calling this is pinned and
+// scheduled as worker 0 from now on, and serves each tick from inside runAllEvents (sparing a
+// wake-up and a context switch per tick), so it must be the one that runs the ticks.
+// A real-time class the process isn't allowed is reported, and the workers run without it.
+void executorPool_initWithConfig(executorPool_t *pool, const executorConfig_t *config, eventStack_t *eventStack, subscriberSet_t *sSet){
+    int threadCount = (config->threadCount < 1) ? 1 : config->threadCount;
+    pool->eventStack = eventStack;
+    pool->sSet = sSet;
+    pool->threadCount = threadCount;
+    pool->tick = 0;
+    pool->busyWorkers = 0;
+    pool->shutdown = 0;
+    pool->spinLimit = EXECUTOR_SPIN_LIMIT;
+    pool->node = config->node;
+    pool->callerIsWorker = (config->callerIsWorker != 0);
+    pthread_mutex_init(&(pool->lock), NULL);
+    pthread_cond_init(&(pool->tickStart), NULL);
+    pthread_cond_init(&(pool->tickDone), NULL);
+    subscriberSet_attachReader(sSet, &(pool->reader));
 
+    // Set up the workers' own state
+    pool->workers = (executorWorker_t *)aligned_alloc(CACHE_LINE_SIZE, threadCount * sizeof(executorWorker_t)); // Perhaps add error checking
+    for(int i = 0; i < threadCount; i++){
+        workerDeque_init(&(pool->workers[i].deque), WORKER_DEQUE_CAPACITY);
+        pool->workers[i].eventStack = eventStack;
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+    }
+    if(pool->callerIsWorker) executorConfig_applyToCaller(config);
 
+    // Create and launch threads (pinned from the start, so their first allocations are node-local)
+    pool->threads = (pthread_t *)malloc(threadCount * sizeof(pthread_t)); // Perhaps add error checking
+    for(int i = pool->callerIsWorker; i < threadCount; i++){
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        executorConfig_applyTo(config, i, &attr);
+        int error = pthread_create(&(pool->threads[i]), &attr, poolWorker, &(pool->workers[i]));
+        if(error == EPERM && config->schedPolicy != SCHED_OTHER){
+            // Not allowed the real-time class: run the worker normally scheduled instead
+            // TODO: Standardize errors over all TPECS functions
+            fprintf(stderr, "Worker %d keeps its scheduling class (%s)\n", i, strerror(error));
+            pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+            error = pthread_create(&(pool->threads[i]), &attr, poolWorker, &(pool->workers[i]));
+        }
+        if(error){
+            errno = error;
+            perror("Failed to create pthread");
+            exit(2);
+        }
+        pthread_attr_destroy(&attr);
+    }
+}
 
-// ========== EVENT DEFINITIONS ==========
-// An event
-typedef struct eventNode{
-    unsigned int type;      // The event's type
-    void *data;             // The event-type-specific data associated with this event
-    struct eventNode *next; // Linked List Link
-} event_t;
+// Initialize an executor pool, launching its (initially parked) worker threads pinned to a
+// NUMA node's CPUs (-1 to leave them unpinned)
+void executorPool_initOnNode(executorPool_t *pool, int threadCount, eventStack_t *eventStack, subscriberSet_t *sSet, int node){
+    executorConfig_t config;
+    executorConfig_init(&config);
+    config.threadCount = threadCount;
+    config.node = node;
+    executorPool_initWithConfig(pool, &config, eventStack, sSet);
+}
 
-// The event stack for live events
-typedef struct eventStack{
-    event_t *head;
-    unsigned int count;
-    pthread_mutex_t lock;
-} eventStack_t;
+// Initialize an executor pool, launching its (initially parked, unpinned) worker threads
+void executorPool_init(executorPool_t *pool, int threadCount, eventStack_t *eventStack, subscriberSet_t *sSet){
+    executorPool_initOnNode(pool, threadCount, eventStack, sSet, -1);
+}
 
-// Initialize an event stack
-void eventStack_init(eventStack_t *eventStack){
-    eventStack->head = NULL;
-    eventStack->count = 0;
-    pthread_mutex_init(&(eventStack->lock), NULL);
+// Set how many times an idle worker polls the queues before parking: 0 parks straight away,
+// more trades CPU time for lower wake-up latency (must not be called while a tick is running)
+void executorPool_setSpinLimit(executorPool_t *pool, unsigned int spinLimit){
+    acquireLock(&(pool->lock));
+    pool->spinLimit = spinLimit;
+    releaseLock(&(pool->lock));
 }
 
-// Prepend a new event to an event stack
-void publish(eventStack_t *eventStack, unsigned int eventType, void *eventData){
-    // Acquire the stack lock
-    if(pthread_mutex_lock(&(eventStack->lock))){
-        perror("Locking failed");
+// Stop and join all of an executor pool's threads, then deallocate it
+// (must not be called while a tick or stream is running)
+void executorPool_shutdown(executorPool_t *pool){
+    // Wake the parked workers with the shutdown flag set
+    acquireLock(&(pool->lock));
+    pool->shutdown = 1;
+    if(pthread_cond_broadcast(&(pool->tickStart))){
+        perror("Signalling failed");
         exit(2);
     }
-    // Ensure that no more than the maximum Events are published
-    if(eventStack->count++ > MAX_PUBLISHABLE_EVENTS){
-        // TODO: Standardize error reporting over all exposed TPECS functionality
-        fprintf(stderr, "Event of type %u could not be published (tick publishing limit reached)\n", eventType);
-    } else {
-        // Allocate, initialize, and push a new event
-        event_t *newEvent = (event_t *)malloc(sizeof(event_t)); // Perhaps add error checking
-        newEvent->next = eventStack->head;
-        newEvent->type = eventType;
-        newEvent->data = eventData;
-        eventStack->head = newEvent;
-    }
-    // Relinquish the stack lock
-    if(pthread_mutex_unlock(&(eventStack->lock))){
-        perror("Unlocking failed");
-        exit(2);
+    releaseLock(&(pool->lock));
+
+    // Finally join with threads
+    for(int i = pool->callerIsWorker; i < pool->threadCount; i++){
+        if(pthread_join(pool->threads[i], NULL)){ // Nothing returned
+            perror("Failed to join pthread");
+            exit(2);
+        }
+    }
+
+    free(pool->threads);
+    for(int i = 0; i < pool->threadCount; i++){
+        workerDeque_destroy(&(pool->workers[i].deque));
     }
+    free(pool->workers);
+    pthread_cond_destroy(&(pool->tickDone));
+    pthread_cond_destroy(&(pool->tickStart));
+    pthread_mutex_destroy(&(pool->lock));
+    subscriberSet_detachReader(pool->sSet, &(pool->reader));
 }
 
-// Remove and return the first event from an event stack
-event_t *popEvent(eventStack_t *eventStack){
-    // Acquire the stack lock
-    if(pthread_mutex_lock(&(eventStack->lock))){
-        perror("Locking failed");
+// Start a tick (or stream) with the pool lock held: reset the budget, publish any subscriptions
+// still pending, start holding dispatch tables and wake the workers.
+// The tick is held open (one event pending) until executorPool_fireTimers has run.
+void executorPool_begin(executorPool_t *pool){
+    // Reset event budgets
+    eventStack_nextEpoch(pool->eventStack);
+
+    subscriberSet_beginTick(pool->sSet, &(pool->reader));
+    atomic_fetch_add(&(pool->eventStack->pending), 1);
+
+    // (a calling worker 0 isn't counted: runAllEvents waits for it anyway, by being it)
+    pool->busyWorkers = pool->threadCount - pool->callerIsWorker;
+    pool->tick++;
+    if(pthread_cond_broadcast(&(pool->tickStart))){
+        perror("Signalling failed");
         exit(2);
     }
-    // Pop the head event if one exists
-    event_t *doomedEvent = eventStack->head;
-    if(doomedEvent != NULL){
-        eventStack->head = doomedEvent->next;
+}
+
+// Queue the deferred events due at the start of a tick (or stream), without the pool lock
+// (so the workers are already serving, and a blocking backpressure policy can wait for them),
+// then let the tick end once everything else is done
+void executorPool_fireTimers(executorPool_t *pool){
+    eventStack_fireTimers(pool->eventStack, 1);
+    finishEvent(pool->eventStack);
+}
+
+// Wait, with the pool lock held, for the last worker to finish the current tick (or stream)
+void executorPool_awaitWorkers(executorPool_t *pool){
+    while(pool->busyWorkers > 0){
+        if(pthread_cond_wait(&(pool->tickDone), &(pool->lock))){
+            perror("Waiting failed");
+            exit(2);
+        }
     }
-    // Relinquish the stack lock
-    if(pthread_mutex_unlock(&(eventStack->lock))){
-        perror("Unlocking failed");
-        exit(2);
+}
+
+// Run one tick: wake the pool's workers (joining them as worker 0 if so configured) and wait
+// until they have emptied all queues
+void runAllEvents(executorPool_t *pool){
+    acquireLock(&(pool->lock));
+    executorPool_begin(pool);
+    releaseLock(&(pool->lock));
+    executorPool_fireTimers(pool);
+    acquireLock(&(pool->lock));
+    if(pool->callerIsWorker){
+        releaseLock(&(pool->lock));
+        executorWorker_t *previousWorker = tCurrentWorker;
+        tCurrentWorker = &(pool->workers[0]);
+        eventExecutor(&(pool->workers[0]));
+        tCurrentWorker = previousWorker;
+        acquireLock(&(pool->lock));
     }
-    return doomedEvent;
+    executorPool_awaitWorkers(pool);
+    releaseLock(&(pool->lock));
+    subscriberSet_endTick(pool->sSet, &(pool->reader));
+
+    // Own up to anything dropped this tick that hasn't been reported yet
+    reportDroppedEvents(pool->eventStack, 1);
 }
 
+// Switch a pool to streaming: its workers serve the stack continuously, parking whenever it is
+// idle and waking on publish, until executorPool_stopStreaming. Events may be published from
+// any thread meanwhile; the tick budget then applies per burst, from idle back to idle.
+// (a calling worker 0 sits streams out, as the caller is free to go and publish)
+// (don't call runAllEvents until the stream is stopped; tables retired meanwhile are only
+//  reclaimed once it is)
+void executorPool_startStreaming(executorPool_t *pool){
+    acquireLock(&(pool->lock));
+    atomic_store(&(pool->eventStack->draining), 0);
+    atomic_store(&(pool->eventStack->streaming), 1);
+    executorPool_begin(pool);
+    releaseLock(&(pool->lock));
+    executorPool_fireTimers(pool);
+}
 
+// Stop streaming: let the workers finish everything already published, then park them again
+// (publishers should stop first; anything published after the drain waits for the next run)
+void executorPool_stopStreaming(executorPool_t *pool){
+    acquireLock(&(pool->lock));
+    atomic_store(&(pool->eventStack->draining), 1);
+    wakeAllExecutors(pool->eventStack);
+    executorPool_awaitWorkers(pool);
+    atomic_store(&(pool->eventStack->streaming), 0);
+    releaseLock(&(pool->lock));
+    subscriberSet_endTick(pool->sSet, &(pool->reader));
 
-// ========== MULTITHREADED EVENT SUBSCRIBER EXECUTION ==========
-// Args for the below function
-typedef struct executorThreadArgs {
-    eventStack_t *eventStack;
-    subscriberSet_t *sSet;
-} executorThreadArgs_t;
+    // Own up to anything dropped during the stream that hasn't been reported yet
+    reportDroppedEvents(pool->eventStack, 1);
+}
 
-// Thread function, repeatedly executes all subscribers to events taken from the event stack
-void *eventExecutor(void *p){
-    // Cast the argument
-    executorThreadArgs_t * args = (executorThreadArgs_t *)p;
 
-    // Fetch events from the stack until there are no more events
-    event_t *currentEvent;
-    do {
-               
-        // Pop a fresh event from the stack
-        currentEvent = popEvent(args->eventStack);
 
-        if (currentEvent != NULL){
-            if(currentEvent->type >= EVENT_TYPES){
-                // Event falls outside the range of valid events
-                // TODO: Standardize errors over all TPECS functions
-                fprintf(stderr, "Event of type %u found (not in valid range 0-%u)\n", currentEvent->type, EVENT_TYPES - 1);
-            } else {
-                // Invoke all subscribers to this event
-                subscriberNode_t *currentSub = args->sSet->map[currentEvent->type];
-                while(currentSub != NULL){
-                    // Run the subscribed function, handing down the event data
-                    currentSub->subscriberFunction(currentEvent->data);
-                    currentSub = currentSub->next;
-                }
+
+
+
+// ========== EVENT LOG REPLAY ==========
+#if PUBSUB_RECORD
+// One record of a loaded event log
+typedef struct logRecord{
+    recordHeader_t header;
+    const unsigned char *payload;   // Its payload, within the log's bytes
+} logRecord_t;
+
+// An event log read back into memory, its records in publish order
+typedef struct eventLog{
+    unsigned char *bytes;           // The whole log file
+    logRecord_t *records;
+    size_t recordCount;
+} eventLog_t;
+
+// Order records by publish time, then by where they are in the log (so one thread's stay in
+// order), for qsort
+int compareLogRecords(const void *a, const void *b){
+    const logRecord_t *left = (const logRecord_t *)a;
+    const logRecord_t *right = (const logRecord_t *)b;
+    if(left->header.publishedAt != right->header.publishedAt) return (left->header.publishedAt > right->header.publishedAt) - (left->header.publishedAt < right->header.publishedAt);
+    return (left->payload > right->payload) - (left->payload < right->payload);
+}
+
+// Read a whole event log into memory; returns zero (having reported why) if it isn't one.
+// Each thread's records are written a buffer at a time, so they are put back in publish order.
+int eventLog_load(eventLog_t *log, FILE *in){
+    log->bytes = NULL;
+    log->records = NULL;
+    log->recordCount = 0;
+
+    // Slurp the file
+    size_t size = 0;
+    size_t capacity = RECORD_BUFFER_BYTES;
+    log->bytes = (unsigned char *)malloc(capacity); // Perhaps add error checking
+    size_t got;
+    while((got = fread(&(log->bytes[size]), 1, capacity - size, in)) > 0){
+        size += got;
+        if(size == capacity){
+            capacity *= 2;
+            log->bytes = (unsigned char *)realloc(log->bytes, capacity); // Perhaps add error checking
+        }
+    }
+    unsigned int fileHeader[2];
+    if(size < sizeof(fileHeader)) fileHeader[0] = 0;
+    else memcpy(fileHeader, log->bytes, sizeof(fileHeader));
+    if(fileHeader[0] != RECORD_MAGIC || fileHeader[1] != RECORD_VERSION){
+        // TODO: Standardize errors over all TPECS functions
+        fprintf(stderr, "Not an event log (or not of version %u)\n", RECORD_VERSION);
+        return 0;
+    }
+
+    // Count, then index, the records
+    for(int pass = 0; pass < 2; pass++){
+        size_t count = 0;
+        size_t offset = sizeof(fileHeader);
+        while(offset + sizeof(recordHeader_t) <= size){
+            recordHeader_t header;
+            memcpy(&header, &(log->bytes[offset]), sizeof(header));
+            if(offset + sizeof(header) + header.length > size) break;
+            if(pass == 1){
+                log->records[count].header = header;
+                log->records[count].payload = &(log->bytes[offset + sizeof(header)]);
+            }
+            count++;
+            offset += sizeof(header) + header.length;
+        }
+        if(pass == 0){
+            if(offset != size) fprintf(stderr, "Event log truncated after %zu records\n", count);
+            log->recordCount = count;
+            log->records = (logRecord_t *)malloc((count + 1) * sizeof(logRecord_t)); // Perhaps add error checking
+        }
+    }
+    qsort(log->records, log->recordCount, sizeof(logRecord_t), compareLogRecords);
+    return 1;
+}
+
+// Deallocate a loaded event log
+void eventLog_destroy(eventLog_t *log){
+    free(log->records);
+    free(log->bytes);
+}
+
+// Play an event log back through a pool: each recorded epoch's events are published to the
+// pool's stack a batch at a time, as they were recorded (payloads copied, keys kept), then run
+// as one tick. Paced, each event waits until as long after the replay started as it was
+// published after the recording did; otherwise the log is replayed at full speed.
+// Returns the number of ticks run.
+unsigned long replay_run(executorPool_t *pool, const eventLog_t *log, int paced){
+    eventStack_t *eventStack = pool->eventStack;
+    eventBatch_t batch;
+    batch.count = 0;
+    unsigned long ticks = 0;
+    unsigned long long replayStart = nowNanos();
+    unsigned long long logStart = (log->recordCount > 0) ? log->records[0].header.publishedAt : 0;
+
+    for(size_t i = 0; i < log->recordCount; i++){
+        const logRecord_t *record = &(log->records[i]);
+        if(paced){
+            unsigned long long due = replayStart + (record->header.publishedAt - logStart);
+            if(due > nowNanos()){
+                // Whatever is already due goes out before we wait
+                eventBatch_flush(&batch, eventStack);
+                struct timespec wakeAt = { (time_t)(due / 1000000000ULL), (long)(due % 1000000000ULL) };
+                while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeAt, NULL) == EINTR);
             }
+        }
+
+        eventBatch_add(&batch, eventStack, record->header.type, record->header.key, record->payload, record->header.length);
 
-            // Deallocate the event's data (N.B. relies on freeing NULL having no effect)
-            free(currentEvent->data);
-            // Deallocate the event
-            free(currentEvent);
+        // The epoch's last event: run its tick
+        if(i + 1 == log->recordCount || log->records[i + 1].header.epoch != record->header.epoch){
+            eventBatch_flush(&batch, eventStack);
+            runAllEvents(pool);
+            ticks++;
         }
-        
-    } while(currentEvent != NULL);
-    return NULL;
+    }
+    return ticks;
 }
+#endif
 
 
-void runAllEvents(int threadCount, eventStack_t *eventStack, subscriberSet_t *sSet){
 
-    // Reset event counter
-    eventStack->count = 0;
+// ========== SHARED-MEMORY TRANSPORT ==========
+#ifdef __linux__
+// One queued event in a shared-memory ring, its payload carried inline
+// (slots are two cache lines, so neighbouring producers don't share one)
+typedef struct shmSlot{
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t sequence; // Equals the slot's position when free, position + 1 when filled
+    unsigned int type;                                // The event's type, on the consuming bus
+    unsigned int length;                              // Payload bytes used
+    unsigned long long key;                           // Its coalescing key (0 for none)
+    unsigned char payload[SHM_PAYLOAD_BYTES];
+} shmSlot_t;
 
-    // Reserve space for threads and args
-    pthread_t threads[threadCount];
-    executorThreadArgs_t args[threadCount];
+// A bounded lock-free MPMC ring of events in shared memory, between producer processes and a
+// bus (laid out as eventRing_t, but holding the events themselves rather than pointers, as
+// nothing else is shared; the processes must agree on the build, as the layout is native)
+typedef struct shmRing{
+    atomic_uint magic;                                   // SHM_RING_MAGIC once the ring is ready
+    unsigned int payloadBytes;                           // SHM_PAYLOAD_BYTES of the build that made it
+    size_t mask;                                         // Capacity - 1 (capacity is a power of two)
+    size_t mappedBytes;                                  // The size of the whole mapping
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t enqueuePos;  // Next position to fill
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t dequeuePos;  // Next position to empty
+    _Alignas(CACHE_LINE_SIZE) atomic_uint sleepers;      // Consumers waiting for events
+    atomic_uint wakeups;                                 // Futex word: bumped to wake them
+    shmSlot_t slots[];
+} shmRing_t;
 
-    // Create and launch threads
-    for(int i = 0; i < threadCount; i++){
-        args[i].eventStack = eventStack;
-        args[i].sSet = sSet;
-        if(pthread_create(&threads[i], NULL, eventExecutor, &args[i])){
-            perror("Failed to create pthread");
-            exit(2);
+// Wait on a futex shared between processes, unless it no longer holds the expected value
+void futexWait(atomic_uint *word, unsigned int expected){
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+// Wake everything waiting on a futex shared between processes
+void futexWakeAll(atomic_uint *word){
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Map a shared-memory object, returning NULL (having reported why) on failure
+shmRing_t *shmRing_map(int fd, size_t bytes){
+    void *mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        perror("Failed to map shared-memory ring");
+        return NULL;
+    }
+    return (shmRing_t *)mapping;
+}
+
+// Create a named shared-memory ring with room for capacity events (rounded up to a power of
+// two), for the consuming bus's side; returns NULL (having reported why) on failure.
+// Creating one that already exists starts it afresh.
+shmRing_t *shmRing_create(const char *name, size_t capacity){
+    size_t slotCount = 1;
+    while(slotCount < capacity) slotCount <<= 1;
+    size_t bytes = sizeof(shmRing_t) + slotCount * sizeof(shmSlot_t);
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if(fd < 0){
+        perror("Failed to create shared-memory ring");
+        return NULL;
+    }
+    if(ftruncate(fd, (off_t)bytes)){
+        perror("Failed to size shared-memory ring");
+        close(fd);
+        return NULL;
+    }
+    shmRing_t *ring = shmRing_map(fd, bytes);
+    if(ring == NULL) return NULL;
+
+    // Producers only touch it once the magic number is in place
+    atomic_store(&(ring->magic), 0);
+    ring->payloadBytes = SHM_PAYLOAD_BYTES;
+    ring->mask = slotCount - 1;
+    ring->mappedBytes = bytes;
+    for(size_t i = 0; i < slotCount; i++){
+        atomic_init(&(ring->slots[i].sequence), i);
+    }
+    atomic_init(&(ring->enqueuePos), 0);
+    atomic_init(&(ring->dequeuePos), 0);
+    atomic_init(&(ring->sleepers), 0);
+    atomic_init(&(ring->wakeups), 0);
+    atomic_store_explicit(&(ring->magic), SHM_RING_MAGIC, memory_order_release);
+    return ring;
+}
+
+// Open an existing named shared-memory ring, for a producer's side; returns NULL (having
+// reported why) if there is none, or it isn't ready or doesn't match this build
+shmRing_t *shmRing_open(const char *name){
+    int fd = shm_open(name, O_RDWR, 0);
+    if(fd < 0){
+        perror("Failed to open shared-memory ring");
+        return NULL;
+    }
+    struct stat info;
+    if(fstat(fd, &info) || (size_t)info.st_size < sizeof(shmRing_t)){
+        // TODO: Standardize errors over all TPECS functions
+        fprintf(stderr, "Shared-memory ring %s is not ready\n", name);
+        close(fd);
+        return NULL;
+    }
+    shmRing_t *ring = shmRing_map(fd, (size_t)info.st_size);
+    if(ring == NULL) return NULL;
+    if(atomic_load_explicit(&(ring->magic), memory_order_acquire) != SHM_RING_MAGIC || ring->payloadBytes != SHM_PAYLOAD_BYTES || ring->mappedBytes != (size_t)info.st_size){
+        // TODO: Standardize errors over all TPECS functions
+        fprintf(stderr, "Shared-memory ring %s is not ready (or from another build)\n", name);
+        munmap(ring, (size_t)info.st_size);
+        return NULL;
+    }
+    return ring;
+}
+
+// Unmap a shared-memory ring (the ring itself lives on until unlinked and unmapped everywhere)
+void shmRing_close(shmRing_t *ring){
+    munmap(ring, ring->mappedBytes);
+}
+
+// Remove a named shared-memory ring's name (processes that have it open keep it)
+void shmRing_unlink(const char *name){
+    shm_unlink(name);
+}
+
+// Publish an event with a copy of the given data to a shared-memory ring, coalescing under the
+// key once on the bus as for publishInlineKeyed. Never blocks, and makes no system call unless
+// a consumer is asleep: returns PUBLISH_OK, or PUBLISH_REJECTED if the ring is full or the data
+// is over SHM_PAYLOAD_BYTES (the caller may retry, or drop it). A producer that dies midway
+// through a publish leaves its slot claimed but never filled, which stalls the ring at that
+// slot for good (consumers see it as about to be filled, so a bridge on it never sleeps
+// again); the ring must then be made afresh.
+int shmRing_publishInlineKeyed(shmRing_t *ring, unsigned int eventType, unsigned long long key, const void *src, size_t len){
+    if(len > SHM_PAYLOAD_BYTES) return PUBLISH_REJECTED;
+    size_t pos = atomic_load_explicit(&(ring->enqueuePos), memory_order_relaxed);
+    shmSlot_t *slot;
+    while(1){
+        slot = &(ring->slots[pos & ring->mask]);
+        size_t seq = atomic_load_explicit(&(slot->sequence), memory_order_acquire);
+        if(seq == pos){
+            // Slot is free this lap; try to claim it
+            if(atomic_compare_exchange_weak(&(ring->enqueuePos), &pos, pos + 1)) break;
+        } else if(seq < pos){
+            // Slot still holds last lap's event: the ring is full
+            return PUBLISH_REJECTED;
+        } else {
+            // Another producer got here first
+            pos = atomic_load_explicit(&(ring->enqueuePos), memory_order_relaxed);
         }
     }
+    slot->type = eventType;
+    slot->length = (unsigned int)len;
+    slot->key = key;
+    memcpy(slot->payload, src, len);
+    atomic_store_explicit(&(slot->sequence), pos + 1, memory_order_release);
 
-    // Finally join with threads
-    for(int i = 0; i < threadCount; i++){
-        if(pthread_join(threads[i], NULL)){ // Nothing returned
-            perror("Failed to join pthread");
-            exit(2);
+    // Wake sleeping consumers (ordered against their check for events, as in submitEvent)
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(&(ring->sleepers), memory_order_relaxed) > 0){
+        atomic_fetch_add(&(ring->wakeups), 1);
+        futexWakeAll(&(ring->wakeups));
+    }
+    return PUBLISH_OK;
+}
+
+// Publish an event with a copy of the given data to a shared-memory ring, as for publishInline
+// (returns as shmRing_publishInlineKeyed)
+int shmRing_publishInline(shmRing_t *ring, unsigned int eventType, const void *src, size_t len){
+    return shmRing_publishInlineKeyed(ring, eventType, 0, src, len);
+}
+
+// Check whether a shared-memory ring holds no events (or only ones still being published)
+int shmRing_isEmpty(shmRing_t *ring){
+    return atomic_load(&(ring->dequeuePos)) >= atomic_load(&(ring->enqueuePos));
+}
+
+// Move up to max events from a shared-memory ring onto an event stack, a batch at a time (as
+// if published there from outside its subscribers); returns how many were taken. This is the
+// direct-consumer side: call it from the tick loop before runAllEvents, say.
+size_t shmRing_drain(shmRing_t *ring, eventStack_t *eventStack, size_t max){
+    eventBatch_t batch;
+    batch.count = 0;
+    size_t drained = 0;
+    size_t pos = atomic_load_explicit(&(ring->dequeuePos), memory_order_relaxed);
+    while(drained < max){
+        shmSlot_t *slot = &(ring->slots[pos & ring->mask]);
+        size_t seq = atomic_load_explicit(&(slot->sequence), memory_order_acquire);
+        if(seq == pos + 1){
+            // Slot is filled; try to claim it, then copy the event out and free the slot
+            if(atomic_compare_exchange_weak(&(ring->dequeuePos), &pos, pos + 1)){
+                // The slot is written by another process, which may yet change it, so its fields
+                // are each read just once (volatile, so not reloaded) and its length isn't taken on trust
+                unsigned int eventType = *(volatile unsigned int *)&(slot->type);
+                unsigned int length = *(volatile unsigned int *)&(slot->length);
+                unsigned long long key = *(volatile unsigned long long *)&(slot->key);
+                if(length <= SHM_PAYLOAD_BYTES){
+                    eventBatch_add(&batch, eventStack, eventType, key, slot->payload, length);
+                } else {
+                    atomic_fetch_add_explicit(&(eventStack->dropped), 1, memory_order_relaxed);
+                    reportDroppedEvents(eventStack, 0);
+                }
+                atomic_store_explicit(&(slot->sequence), pos + ring->mask + 1, memory_order_release);
+                drained++;
+                pos++;
+            }
+        } else if(seq < pos + 1){
+            // Slot not yet filled: the ring is empty
+            break;
+        } else {
+            // Another consumer got here first
+            pos = atomic_load_explicit(&(ring->dequeuePos), memory_order_relaxed);
+        }
+    }
+    eventBatch_flush(&batch, eventStack);
+    return drained;
+}
+
+// Sleep until a shared-memory ring may have events, or until *stopping is set (returns at once
+// if either is already so; stopping may be NULL). Whoever sets *stopping must then bump the
+// ring's wakeups and wake its futex, as shmBridge_stop does, for this to see it.
+void shmRing_wait(shmRing_t *ring, atomic_int *stopping){
+    unsigned int wakeups = atomic_load(&(ring->wakeups));
+    atomic_fetch_add(&(ring->sleepers), 1);
+    // Checked only after reading wakeups, so a stop or publish after this is sure to change it
+    if(shmRing_isEmpty(ring) && (stopping == NULL || !atomic_load(stopping))) futexWait(&(ring->wakeups), wakeups);
+    atomic_fetch_sub(&(ring->sleepers), 1);
+}
+
+// A thread feeding a shared-memory ring's events into an event stack as they arrive (for a
+// streaming pool, or for ticks that would rather not drain the ring themselves). The stack's
+// backpressure policy applies: under BACKPRESSURE_BLOCK the bridge waits for room, leaving
+// the ring to fill and push back on its producers, rather than dropping.
+typedef struct shmBridge{
+    shmRing_t *ring;
+    eventStack_t *eventStack;
+    pthread_t thread;
+    unsigned int spinLimit;   // Empty polls the bridge makes before sleeping (EXECUTOR_SPIN_LIMIT by default)
+    atomic_int stopping;      // Nonzero once the bridge should exit
+} shmBridge_t;
+
+// Thread function for bridges: drain the ring whenever it has events, polling a while when it
+// runs dry, then sleeping on the ring's futex until a producer wakes it
+void *shmBridge_run(void *p){
+    shmBridge_t *bridge = (shmBridge_t *)p;
+    unsigned int idleSpins = 0;
+    while(!atomic_load(&(bridge->stopping))){
+        if(shmRing_drain(bridge->ring, bridge->eventStack, EVENT_BATCH_SIZE) > 0){
+            idleSpins = 0;
+        } else if(idleSpins < bridge->spinLimit){
+            idleSpins++;
+            cpuRelax();
+        } else {
+            shmRing_wait(bridge->ring, &(bridge->stopping));
+            idleSpins = 0;
         }
-    } 
+    }
 
+    // Hand over whatever was published before the stop
+    while(shmRing_drain(bridge->ring, bridge->eventStack, EVENT_BATCH_SIZE) > 0);
+    eventAllocator_releaseThread();
+    stats_releaseThread();
+    return NULL;
+}
+
+// Start a bridge thread feeding a shared-memory ring into an event stack
+void shmBridge_start(shmBridge_t *bridge, shmRing_t *ring, eventStack_t *eventStack){
+    bridge->ring = ring;
+    bridge->eventStack = eventStack;
+    bridge->spinLimit = EXECUTOR_SPIN_LIMIT;
+    atomic_init(&(bridge->stopping), 0);
+    if(pthread_create(&(bridge->thread), NULL, shmBridge_run, bridge)){
+        perror("Failed to create pthread");
+        exit(2);
+    }
+}
+
+// Stop a bridge thread, once it has moved everything already in the ring onto the stack
+void shmBridge_stop(shmBridge_t *bridge){
+    atomic_store(&(bridge->stopping), 1);
+    atomic_fetch_add(&(bridge->ring->wakeups), 1);
+    futexWakeAll(&(bridge->ring->wakeups));
+    if(pthread_join(bridge->thread, NULL)){
+        perror("Failed to join pthread");
+        exit(2);
+    }
+}
+#endif
+
+
+
+// ========== BUS INSTANCES ==========
+// One complete, independent bus: its own event types and subscribers, event stack and
+// executors, none of them shared with any other bus in the process (one per NUMA node, say)
+typedef struct bus{
+    subscriberSet_t sSet;
+    eventStack_t eventStack;
+    executorPool_t pool;
+    int node;                   // The NUMA node the bus lives on (-1 for none in particular)
+} bus_t;
+
+// Create a bus whose executors run as configured, on the configuration's NUMA node (-1 for anywhere).
+// Everything the bus allocates (itself, its queues, its workers' event node caches) is first
+// touched from that node's CPUs, so is node-local, and its workers stay on those CPUs
+// (or on the configuration's per-worker masks, if it has them).
+// Publishers outside the bus should run on its node too: event nodes come from the publishing thread.
+bus_t *bus_createWithConfig(const executorConfig_t *config){
+    executorConfig_t placed = *config;
+    int node = placed.node;
+    if(node >= 0 && !numa_nodeExists(node)){
+        // TODO: Standardize errors over all TPECS functions
+        fprintf(stderr, "NUMA node %d not found; bus placed on no node in particular\n", node);
+        node = -1;
+        placed.node = -1;
+    }
+    nodeAffinity_t affinity;
+    numa_enterNode(node, &affinity);
+
+    bus_t *bus = (bus_t *)aligned_alloc(CACHE_LINE_SIZE, (sizeof(bus_t) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE); // Perhaps add error checking
+    memset(bus, 0, sizeof(bus_t));
+    bus->node = node;
+    initSubscriberSet(&(bus->sSet));
+    eventStack_init(&(bus->eventStack), &(bus->sSet));
+    executorPool_initWithConfig(&(bus->pool), &placed, &(bus->eventStack), &(bus->sSet));
+
+    // (a calling worker 0 has been pinned for good, so stays put)
+    if(!placed.callerIsWorker) numa_leaveNode(&affinity);
+    return bus;
+}
+
+// Create a bus with the given number of executor threads on a NUMA node (-1 for anywhere)
+bus_t *bus_create(int threadCount, int node){
+    executorConfig_t config;
+    executorConfig_init(&config);
+    config.threadCount = threadCount;
+    config.node = node;
+    return bus_createWithConfig(&config);
+}
+
+// Shut a bus's executors down and deallocate it (must not be called while a tick or stream is running)
+void bus_destroy(bus_t *bus){
+    executorPool_shutdown(&(bus->pool));
+    eventStack_destroy(&(bus->eventStack));
+    destroySubscriberSet(&(bus->sSet));
+    free(bus);
+}
+
+// Forward an event to another bus, as one of its own event types (type IDs are per bus, so
+// look it up there by name). The data is always copied, into the target stack's inbox (in the
+// target's memory), and the target's own workers make the event node as they take it in, so
+// the node is theirs, on their node. Payloads over EVENT_INLINE_BYTES are still heap copies
+// made by the sender, and with the inbox full, the sender publishes the event itself as before.
+// Returns as eventStack_forward.
+// (An executor forwarding never waits for room under BACKPRESSURE_BLOCK, whichever bus it serves.)
+int bus_forward(bus_t *target, unsigned int eventType, const void *src, size_t len){
+    return eventStack_forward(&(target->eventStack), eventType, src, len);
 }
 
 
@@ -208,78 +4497,495 @@ void runAllEvents(int threadCount, eventStack_t *eventStack, subscriberSet_t *sS
 
 
 // ========== TEST CODE ==========
+#define DEMO_EVENT_TYPES 26  // One event type per letter of the demo's input
+#define DEMO_BATCH_SIZE 64   // Input events published per batch (by the benchmark too)
+
+#ifndef PUBSUB_BENCH
 
 
 // Dummy Globals (in the real use case, this would be part of the root World struct to protect namespace)
-// We would also hand the world struct down to the subscriber functions
+// Subscribers never touch them: they publish through their handle, and would get the World as their context
 subscriberSet_t gSSet;
 eventStack_t gEStack;
 
 
 // Dummy Subscribers
-void testSubOne(void *arg){
+void testSubOne(void *ctx, void *arg, publisher_t *publisher){
     printf("This is a '0'-type subscriber!\n");
 }
-void testSubTwo(void *arg){
+void testSubTwo(void *ctx, void *arg, publisher_t *publisher){
     printf("This is a '1'-type subscriber, and it generates a '0'-type event!\n");
-    publish(&gEStack, 0, NULL);
+    publisher_publish(publisher, 0, NULL);
 }
 
-void testSubThree(void *arg){
+void testSubThree(void *ctx, void *arg, publisher_t *publisher){
     if(arg == NULL){
         printf("This is a '2'-type subscriber with no data\n");
     } else {
         printf("This is a '2'-type subscriber; here's the event's datum: %d\n", *(int *)arg);
     }
 }
-void testSubFour(void *arg){
+void testSubFour(void *ctx, void *arg, publisher_t *publisher){
     printf("This is a '3'-type subscriber, and it generates '2'-type events with a datum of 32!\n");
-    int *p = (int *)malloc(sizeof(int));
-    *p = 32;
-    publish(&gEStack, 2, p);
+    int datum = 32;
+    publisher_publishInline(publisher, 2, &datum, sizeof(datum));
 }
-void testSubFive(void *arg){
+void testSubFive(void *ctx, void *arg, publisher_t *publisher){
     printf("This is a '4'-type subscriber, and it generates '2'-type events with a datum of 64!\n");
-    int *p = (int *)malloc(sizeof(int));
-    *p = 64;
-    publish(&gEStack, 2, p);
+    int datum = 64;
+    publisher_publishInline(publisher, 2, &datum, sizeof(datum));
 }
 
-void testSubRecursion(void *arg){
+void testSubRecursion(void *ctx, void *arg, publisher_t *publisher){
     printf("This is a '5'-type subscriber, and it generates another '5'-type event!\n");
-    publish(&gEStack, 5, NULL);
+    publisher_publish(publisher, 5, NULL);
 }
 
 
 
 // Test Driver
-int main(void){
+int main(int argc, char **argv){
+    // With --stream, events are served as they arrive instead of in one tick after the input ends;
+    // with --trace <file>, every event's dispatch (and what published it) is traced to the file;
+    // --threads <n> sets the worker count, and --caller-worker makes this thread one of them;
+    // with --coalesce, the recursion storm is tamed by letting a pending '5' absorb new ones;
+    // --record <file> logs the input's events, and --replay <file> takes them from a log instead
+    // of stdin (as fast as possible, or as they were recorded with --paced)
+    int streaming = 0;
+    int coalescing = 0;
+    int paced = 0;
+    const char *tracePath = NULL;
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+    executorConfig_t config;
+    executorConfig_init(&config);
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--stream") == 0){
+            streaming = 1;
+        } else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc){
+            tracePath = argv[++i];
+        } else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+            config.threadCount = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--caller-worker") == 0){
+            config.callerIsWorker = 1;
+        } else if(strcmp(argv[i], "--coalesce") == 0){
+            coalescing = 1;
+        } else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc){
+            recordPath = argv[++i];
+        } else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc){
+            replayPath = argv[++i];
+        } else if(strcmp(argv[i], "--paced") == 0){
+            paced = 1;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+#if PUBSUB_TRACE
+    if(tracePath != NULL) trace_start(1);
+#else
+    if(tracePath != NULL) fprintf(stderr, "Tracing is not built in (PUBSUB_TRACE=0)\n");
+#endif
+#if !PUBSUB_RECORD
+    if(recordPath != NULL || replayPath != NULL || paced){
+        fprintf(stderr, "Event logs are not built in (PUBSUB_RECORD=0)\n");
+        return 2;
+    }
+#endif
 
-    // Init sample set of subscribers
+    // Init sample set of subscribers, with an event type named for each letter
     initSubscriberSet(&gSSet);
+    for(int i = 0; i < DEMO_EVENT_TYPES; i++){
+        char name[2] = { (char)('a' + i), '\0' };
+        registerEventType(&gSSet, name);
+    }
 
-    // Get some subscribers (this will be done at start of actual use-case app)
-    subscribe(&gSSet, 0, testSubOne);
-    subscribe(&gSSet, 1, testSubTwo);
-    subscribe(&gSSet, 2, testSubThree);
-    subscribe(&gSSet, 3, testSubFour);
-    subscribe(&gSSet, 4, testSubFive);
-    subscribe(&gSSet, 5, testSubRecursion);
-    subscribe(&gSSet, 5, testSubRecursion); // Double the recursion!
+    // Get some subscribers (this will be done at start of actual use-case app; with
+    // -DDEMO_STATIC_SUBSCRIBERS, they are compiled in instead)
+#ifndef DEMO_STATIC_SUBSCRIBERS
+    subscribe(&gSSet, 0, testSubOne, NULL);
+    subscribe(&gSSet, 1, testSubTwo, NULL);
+    subscribe(&gSSet, 2, testSubThree, NULL);
+    subscribe(&gSSet, 3, testSubFour, NULL);
+    subscribe(&gSSet, 4, testSubFive, NULL);
+    subscribe(&gSSet, 5, testSubRecursion, NULL);
+    subscribe(&gSSet, 5, testSubRecursion, NULL); // Double the recursion!
+#endif
+
+    // '0'-type events are latency-critical, so jump the queue ahead of any recursion storm
+    setEventPriority(&gSSet, 0, 1);
+    if(coalescing) setEventCoalescing(&gSSet, 5, COALESCE_TYPE, NULL);
 
     // Init sample starting stack of events
-    eventStack_init(&gEStack);
+    eventStack_init(&gEStack, &gSSet);
+
+    // Start the executor pool (in the real use case, this lives as long as the World)
+    executorPool_t pool;
+    executorPool_initWithConfig(&pool, &config, &gEStack, &gSSet);
+#if PUBSUB_RECORD
+    FILE *recordFile = NULL;
+    if(recordPath != NULL){
+        recordFile = fopen(recordPath, "wb");
+        if(recordFile == NULL){
+            perror("Failed to open event log");
+        } else {
+            record_start(&gEStack, recordFile);
+        }
+    }
 
-    // add events to the stack from user
-    char controlChar;
-    while((controlChar = getchar()) != '\n'){
-        publish(&gEStack, controlChar - 'a', NULL);
+    if(replayPath != NULL){
+        // Play the log back through the pool, tick by recorded tick
+        FILE *replayFile = fopen(replayPath, "rb");
+        eventLog_t log;
+        if(replayFile == NULL){
+            perror("Failed to open event log");
+        } else if(eventLog_load(&log, replayFile)){
+            unsigned long long replayStart = nowNanos();
+            unsigned long ticks = replay_run(&pool, &log, paced);
+            fprintf(stderr, "Replayed %zu event(s) in %lu tick(s), %.3f ms\n", log.recordCount, ticks, (nowNanos() - replayStart) / 1e6);
+            eventLog_destroy(&log);
+        }
+        if(replayFile != NULL) fclose(replayFile);
+    } else
+#endif
+    if(streaming){
+        // Publish each event from user as soon as it is read, while the pool serves them
+        executorPool_startStreaming(&pool);
+        int inputChar;
+        while((inputChar = getchar()) != EOF && inputChar != '\n'){
+            publish(&gEStack, inputChar - 'a', NULL);
+        }
+        executorPool_stopStreaming(&pool);
+    } else {
+        // add events to the stack from user, a batch at a time
+        event_t batch[DEMO_BATCH_SIZE];
+        size_t batchSize = 0;
+        char controlChar;
+        while((controlChar = getchar()) != '\n'){
+            batch[batchSize].type = controlChar - 'a';
+            batch[batchSize].flags = 0;
+            batch[batchSize].data = NULL;
+            batch[batchSize].release = NULL;
+            if(++batchSize == DEMO_BATCH_SIZE){
+                publishBatch(&gEStack, batch, batchSize);
+                batchSize = 0;
+            }
+        }
+        publishBatch(&gEStack, batch, batchSize);
+
+        // Run the constructed stack
+        runAllEvents(&pool);
     }
 
-    // Run the constructed stack
-    runAllEvents(THREAD_COUNT, &gEStack, &gSSet);
-    
     // Clean up
+#if PUBSUB_RECORD
+    if(recordFile != NULL){
+        record_stop();
+        fclose(recordFile);
+    }
+    record_destroy();
+#endif
+    executorPool_shutdown(&pool);
+#if PUBSUB_TIMING
+    subscriberTiming_dump(stderr, &gSSet, 5);
+    subscriberTiming_destroy();
+#endif
+#if PUBSUB_TRACE
+    if(tracePath != NULL){
+        trace_stop();
+        FILE *traceFile = fopen(tracePath, "w");
+        if(traceFile == NULL){
+            perror("Failed to open trace file");
+        } else {
+            trace_export(traceFile, &gSSet);
+            fclose(traceFile);
+        }
+    }
+    trace_destroy();
+#endif
+    eventStack_destroy(&gEStack);
     destroySubscriberSet(&gSSet);
+    eventAllocator_destroy();
+
+}
+#else
+// ========== BENCHMARK HARNESS ==========
+// Built with -DPUBSUB_BENCH in place of the demo: synthetic workloads run over many ticks, for
+// each thread count from 1 up, with the queue and allocator backends as built
+#define BENCH_FANOUT 0  // Event type with many subscribers (like testSubTwo's)
+#define BENCH_STORM 1   // Event type whose subscriber republishes it (like testSubRecursion)
+#define BENCH_PAYLOAD 2 // Event type with a heap-sized payload (like testSubFour's, only bigger)
+
+// What every bench event carries (at the head of its payload)
+typedef struct benchPayload{
+    unsigned long long publishedAt; // nowNanos() when it was published
+    unsigned int depth;             // Republishes still to come (storm events only)
+} benchPayload_t;
+
+// One thread's publish-to-dispatch latency samples (in ns)
+typedef struct benchSamples{
+    unsigned long long *latencies;
+    size_t count;
+    size_t capacity;
+    struct benchSamples *next; // Linked List Link (all threads' samples)
+} benchSamples_t;
+
+// The benchmark's settings (see main for the options setting them)
+typedef struct benchConfig{
+    int maxThreads;        // Thread counts run are 1 up to this
+    unsigned int ticks;    // Ticks per run
+    unsigned int events;   // Events per tick (storms count every generation)
+    unsigned int fanout;   // Subscribers to each fanout event
+    unsigned int depth;    // Generations of each storm after its seed
+    unsigned int work;     // Busy-loop iterations per subscriber call
+    size_t payloadBytes;   // Size of each payload event's data
+    int pin;               // Nonzero to pin worker i to CPU i (modulo the CPUs online)
+    int callerIsWorker;    // Nonzero to have the benchmark thread serve as worker 0
+    unsigned int split;    // Fanout subscribers per parallel task (0 to run each event's on one worker)
+} benchConfig_t;
+
+benchConfig_t gBench = { THREAD_COUNT, 1000, 256, 8, 15, 0, 256, 0, 0, 0 };
+subscriberSet_t gBenchSSet;
+eventStack_t gBenchStack;
+benchSamples_t *gBenchSamples = NULL;
+pthread_mutex_t gBenchSamplesLock = PTHREAD_MUTEX_INITIALIZER;
+_Thread_local benchSamples_t *tBenchSamples = NULL;
+
+// Record an event's publish-to-dispatch latency on the calling thread
+void benchRecord(const benchPayload_t *payload){
+    unsigned long long latency = nowNanos() - payload->publishedAt;
+    benchSamples_t *samples = tBenchSamples;
+    if(samples == NULL){
+        samples = (benchSamples_t *)calloc(1, sizeof(benchSamples_t)); // Perhaps add error checking
+        acquireLock(&gBenchSamplesLock);
+        samples->next = gBenchSamples;
+        gBenchSamples = samples;
+        releaseLock(&gBenchSamplesLock);
+        tBenchSamples = samples;
+    }
+    if(samples->count == samples->capacity){
+        samples->capacity = (samples->capacity == 0) ? 4096 : samples->capacity * 2;
+        samples->latencies = (unsigned long long *)realloc(samples->latencies, samples->capacity * sizeof(unsigned long long)); // Perhaps add error checking
+    }
+    samples->latencies[samples->count++] = latency;
+}
+
+// Burn the configured subscriber cost
+void benchWork(const benchConfig_t *config){
+    volatile unsigned long sink = 0;
+    for(unsigned int i = 0; i < config->work; i++){
+        sink += i;
+    }
+}
+
+// Bench Subscribers (each subscribed with the benchmark's settings as its context)
+void benchSubFanoutFirst(void *ctx, void *arg, publisher_t *publisher){
+    benchRecord((benchPayload_t *)arg);
+    benchWork((const benchConfig_t *)ctx);
+}
+
+void benchSubFanoutRest(void *ctx, void *arg, publisher_t *publisher){
+    benchWork((const benchConfig_t *)ctx);
+}
+
+void benchSubStorm(void *ctx, void *arg, publisher_t *publisher){
+    benchPayload_t *payload = (benchPayload_t *)arg;
+    benchRecord(payload);
+    benchWork((const benchConfig_t *)ctx);
+    if(payload->depth > 0){
+        benchPayload_t next = { nowNanos(), payload->depth - 1 };
+        publisher_publishInline(publisher, BENCH_STORM, &next, sizeof(next));
+    }
+}
+
+void benchSubPayload(void *ctx, void *arg, publisher_t *publisher){
+    const benchConfig_t *config = (const benchConfig_t *)ctx;
+    benchRecord((benchPayload_t *)arg);
+    // Read the whole payload, as a real consumer would
+    const unsigned char *bytes = (const unsigned char *)arg;
+    volatile unsigned long sum = 0;
+    for(size_t i = 0; i < config->payloadBytes; i++){
+        sum += bytes[i];
+    }
+    benchWork(config);
+}
 
+// Publish one tick's worth of seed events for a workload
+void benchSeed(unsigned int eventType){
+    if(eventType == BENCH_PAYLOAD){
+        unsigned char *buffer = (unsigned char *)calloc(1, gBench.payloadBytes); // Perhaps add error checking
+        for(unsigned int i = 0; i < gBench.events; i++){
+            benchPayload_t payload = { nowNanos(), 0 };
+            memcpy(buffer, &payload, sizeof(payload));
+            publishInline(&gBenchStack, eventType, buffer, gBench.payloadBytes);
+        }
+        free(buffer);
+        return;
+    }
+
+    // Storms seed one event per generation's worth of events
+    unsigned int seeds = (eventType == BENCH_STORM) ? gBench.events / (gBench.depth + 1) : gBench.events;
+    if(seeds == 0) seeds = 1;
+    event_t batch[DEMO_BATCH_SIZE];
+    size_t batchSize = 0;
+    for(unsigned int i = 0; i < seeds; i++){
+        benchPayload_t payload = { nowNanos(), (eventType == BENCH_STORM) ? gBench.depth : 0 };
+        batch[batchSize].type = eventType;
+        batch[batchSize].flags = EVENT_DATA_INLINE;
+        batch[batchSize].release = NULL;
+        memcpy(batch[batchSize].inlineData.bytes, &payload, sizeof(payload));
+        if(++batchSize == DEMO_BATCH_SIZE){
+            publishBatch(&gBenchStack, batch, batchSize);
+            batchSize = 0;
+        }
+    }
+    publishBatch(&gBenchStack, batch, batchSize);
+}
+
+// Order latencies for qsort
+int benchCompareLatencies(const void *a, const void *b){
+    unsigned long long left = *(const unsigned long long *)a;
+    unsigned long long right = *(const unsigned long long *)b;
+    return (left > right) - (left < right);
+}
+
+// Run one workload for the configured number of ticks on a fresh pool, and print its results
+void benchRun(const char *name, unsigned int eventType, int threadCount){
+    // Forget the last run's samples (all its workers are gone)
+    for(benchSamples_t *samples = gBenchSamples; samples != NULL; samples = samples->next){
+        samples->count = 0;
+    }
+
+    pubsubStats_t before;
+    pubsubStats_t after;
+    pubsub_stats(&gBenchStack, &before);
+
+    executorConfig_t config;
+    executorConfig_init(&config);
+    config.threadCount = threadCount;
+    config.callerIsWorker = gBench.callerIsWorker;
+#ifdef __linux__
+    cpu_set_t *cpus = NULL;
+    if(gBench.pin){
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        cpus = (cpu_set_t *)malloc(threadCount * sizeof(cpu_set_t)); // Perhaps add error checking
+        for(int i = 0; i < threadCount; i++){
+            CPU_ZERO(&(cpus[i]));
+            CPU_SET(i % ((online > 0) ? online : 1), &(cpus[i]));
+        }
+        config.cpus = cpus;
+    }
+#endif
+
+    executorPool_t pool;
+    executorPool_initWithConfig(&pool, &config, &gBenchStack, &gBenchSSet);
+    unsigned long long start = nowNanos();
+    for(unsigned int tick = 0; tick < gBench.ticks; tick++){
+        benchSeed(eventType);
+        runAllEvents(&pool);
+    }
+    unsigned long long elapsed = nowNanos() - start;
+    executorPool_shutdown(&pool);
+    pubsub_stats(&gBenchStack, &after);
+#ifdef __linux__
+    free(cpus);
+#endif
+
+    // Gather every thread's samples, one per event dispatched
+    size_t total = 0;
+    for(benchSamples_t *samples = gBenchSamples; samples != NULL; samples = samples->next){
+        total += samples->count;
+    }
+    unsigned long long *latencies = (unsigned long long *)malloc((total + 1) * sizeof(unsigned long long)); // Perhaps add error checking
+    size_t gathered = 0;
+    for(benchSamples_t *samples = gBenchSamples; samples != NULL; samples = samples->next){
+        memcpy(&(latencies[gathered]), samples->latencies, samples->count * sizeof(unsigned long long));
+        gathered += samples->count;
+    }
+    qsort(latencies, total, sizeof(unsigned long long), benchCompareLatencies);
+    unsigned long long p50 = (total > 0) ? latencies[(total - 1) * 500 / 1000] : 0;
+    unsigned long long p99 = (total > 0) ? latencies[(total - 1) * 990 / 1000] : 0;
+    unsigned long long p999 = (total > 0) ? latencies[(total - 1) * 999 / 1000] : 0;
+    free(latencies);
+
+    printf("%-8s %7d %10zu %14.0f %10llu %10llu %10llu %9lu %9lu %9lu %9lu\n", name, threadCount, total, total / (elapsed / 1e9), p50, p99, p999,
+           after.steals - before.steals, after.parks - before.parks, after.lockContended - before.lockContended, after.dropped - before.dropped);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv){
+    // Options come in pairs: --threads N, --ticks N, --events N, --fanout N, --depth N, --work N, --payload N,
+    // --pin 0/1, --caller 0/1, --split N
+    for(int i = 1; i < argc; i += 2){
+        if(i + 1 >= argc){
+            fprintf(stderr, "Option %s needs a value\n", argv[i]);
+            return 2;
+        }
+        unsigned long value = strtoul(argv[i + 1], NULL, 10);
+        if(strcmp(argv[i], "--threads") == 0){
+            gBench.maxThreads = (int)value;
+        } else if(strcmp(argv[i], "--ticks") == 0){
+            gBench.ticks = (unsigned int)value;
+        } else if(strcmp(argv[i], "--events") == 0){
+            gBench.events = (unsigned int)value;
+        } else if(strcmp(argv[i], "--fanout") == 0){
+            gBench.fanout = (unsigned int)value;
+        } else if(strcmp(argv[i], "--depth") == 0){
+            gBench.depth = (unsigned int)value;
+        } else if(strcmp(argv[i], "--work") == 0){
+            gBench.work = (unsigned int)value;
+        } else if(strcmp(argv[i], "--payload") == 0){
+            gBench.payloadBytes = (value < sizeof(benchPayload_t)) ? sizeof(benchPayload_t) : value;
+        } else if(strcmp(argv[i], "--pin") == 0){
+            gBench.pin = (value != 0);
+        } else if(strcmp(argv[i], "--caller") == 0){
+            gBench.callerIsWorker = (value != 0);
+        } else if(strcmp(argv[i], "--split") == 0){
+            gBench.split = (unsigned int)value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // One event type per workload
+    initSubscriberSet(&gBenchSSet);
+    registerEventType(&gBenchSSet, "fanout");
+    registerEventType(&gBenchSSet, "storm");
+    registerEventType(&gBenchSSet, "payload");
+    subscribe(&gBenchSSet, BENCH_FANOUT, benchSubFanoutFirst, &gBench);
+    for(unsigned int i = 1; i < gBench.fanout; i++){
+        subscribe(&gBenchSSet, BENCH_FANOUT, benchSubFanoutRest, &gBench);
+    }
+    setEventFanout(&gBenchSSet, BENCH_FANOUT, gBench.split);
+    subscribe(&gBenchSSet, BENCH_STORM, benchSubStorm, &gBench);
+    subscribe(&gBenchSSet, BENCH_PAYLOAD, benchSubPayload, &gBench);
+    eventStack_init(&gBenchStack, &gBenchSSet);
+
+    printf("# queue backend %d, allocator %d, %d shard(s); %u ticks of %u events; fanout %u (split %u), storm depth %u, payload %zu bytes, work %u%s%s\n",
+           EVENT_QUEUE_BACKEND, EVENT_ALLOCATOR, EVENT_SHARDS, gBench.ticks, gBench.events, gBench.fanout, gBench.split, gBench.depth, gBench.payloadBytes, gBench.work,
+           gBench.pin ? "; pinned" : "", gBench.callerIsWorker ? "; caller is worker 0" : "");
+    printf("%-8s %7s %10s %14s %10s %10s %10s %9s %9s %9s %9s\n", "workload", "threads", "events", "events/s", "p50 ns", "p99 ns", "p999 ns", "steals", "parks", "contended", "dropped");
+    for(int threadCount = 1; threadCount <= gBench.maxThreads; threadCount++){
+        benchRun("fanout", BENCH_FANOUT, threadCount);
+        benchRun("storm", BENCH_STORM, threadCount);
+        benchRun("payload", BENCH_PAYLOAD, threadCount);
+    }
+
+    // Clean up
+#if PUBSUB_TIMING
+    printf("# slowest subscribers, over every run\n");
+    subscriberTiming_dump(stdout, &gBenchSSet, 5);
+    subscriberTiming_destroy();
+#endif
+    eventStack_destroy(&gBenchStack);
+    destroySubscriberSet(&gBenchSSet);
+    while(gBenchSamples != NULL){
+        benchSamples_t *doomedSamples = gBenchSamples;
+        gBenchSamples = doomedSamples->next;
+        free(doomedSamples->latencies);
+        free(doomedSamples);
+    }
+    eventAllocator_destroy();
 }
+#endif
@@ -0,0 +1,47 @@
+// Compile-time subscriber registration for pubSub.c
+//
+// Subscriptions known at build time can skip the subscriber set altogether: list them in an
+// X-macro named PUBSUB_STATIC_TYPES before pubSub.c is compiled (-D, or a #define ahead of
+// including it), and the executor dispatches each listed type through a generated switch of
+// direct calls, which the compiler can inline, ahead of the type's dynamic subscribers
+// (written over several lines, each but the last ending in a backslash):
+//
+//     #define PUBSUB_STATIC_TYPES(TYPE, SUBSCRIBER)
+//         TYPE(0, SUBSCRIBER(onTick, NULL))
+//         TYPE(3, SUBSCRIBER(onDamage, &gWorld) SUBSCRIBER(logDamage, NULL))
+//
+// Each TYPE gives a registered event type's ID and its subscribers, run in the order listed
+// (a type may only be listed once); each SUBSCRIBER a subscriber function and the context it
+// is called with, an expression evaluated at every call. Prototypes are generated for the
+// functions, so they need external linkage. Static subscribers can't be unsubscribed, and
+// aren't timed by PUBSUB_TIMING, but are counted in the subscriberCalls statistic.
+
+#ifndef PUBSUB_STATIC_H
+#define PUBSUB_STATIC_H
+
+// Expanded once for the prototypes...
+#define PUBSUB_STATIC_DECLARE_TYPE(eventType, subscribers) subscribers
+#define PUBSUB_STATIC_DECLARE(subscriberFunction, ctx) void subscriberFunction(void *, void *, publisher_t *);
+
+// ... and once for the switch
+#define PUBSUB_STATIC_CASE(eventType, subscribers) case (eventType): subscribers break;
+#define PUBSUB_STATIC_CALL(subscriberFunction, ctx) subscriberFunction((ctx), data, publisher); calls++;
+
+PUBSUB_STATIC_TYPES(PUBSUB_STATIC_DECLARE_TYPE, PUBSUB_STATIC_DECLARE)
+
+// Run the statically registered subscribers to an event of the given type (if any)
+static inline void staticSubscribers_dispatch(unsigned int eventType, void *data, publisher_t *publisher){
+    unsigned int calls = 0;
+    switch(eventType){
+    PUBSUB_STATIC_TYPES(PUBSUB_STATIC_CASE, PUBSUB_STATIC_CALL)
+    default:
+        return;
+    }
+#if PUBSUB_STATS
+    STATS_ADD(subscriberCalls, calls);
+#else
+    (void)calls;
+#endif
+}
+
+#endif